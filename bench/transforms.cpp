@@ -0,0 +1,59 @@
+// Times Transforms::propagate and Transforms::cull on generated trees of growing size.
+// usage: voicetuber-bench-transforms [max nodes]
+#include "transforms.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <vector>
+
+static auto bench(int n, bool deep) -> void
+{
+  auto transforms = Transforms{};
+  auto slots = std::vector<Transforms::Slot>{};
+  slots.reserve(static_cast<size_t>(n));
+  auto rng = std::minstd_rand{42};
+  auto coord = std::uniform_real_distribution<float>{-200.f, 200.f};
+  for (auto i = 0; i < n; ++i)
+  {
+    auto &slot = slots.emplace_back(transforms);
+    slot.get<&Transforms::Page::loc>() = {coord(rng), coord(rng)};
+    slot.get<&Transforms::Page::rot>() = coord(rng);
+    slot.get<&Transforms::Page::size>() = {64.f, 64.f};
+  }
+
+  // a parent always comes before its children: either a long chain or a wide random tree
+  transforms.clearOrder();
+  for (auto i = 0; i < n; ++i)
+  {
+    const auto parent = i == 0 ? -1 : deep ? i - 1 : static_cast<int>(rng() % static_cast<unsigned>(i));
+    transforms.pushOrder(slots[static_cast<size_t>(i)].id(), parent);
+  }
+
+  const auto proj = glm::ortho(0.f, 1920.f, 0.f, 1080.f);
+  const auto iterations = std::max(10, 2'000'000 / n);
+  const auto start = std::chrono::steady_clock::now();
+  for (auto it = 0; it < iterations; ++it)
+  {
+    transforms.propagate(glm::mat4{1.f});
+    transforms.cull(proj);
+  }
+  const auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  fmt::print("{:>8} nodes {:>5}: {:>10.1f} us/frame {:>6.1f} ns/node\n",
+             n,
+             deep ? "chain" : "wide",
+             ns / iterations / 1000.,
+             ns / iterations / n);
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+  const auto maxNodes = argc > 1 ? std::atoi(argv[1]) : 65536;
+  for (auto n = 16; n <= maxNodes; n *= 4)
+  {
+    bench(n, false);
+    bench(n, true);
+  }
+  return 0;
+}
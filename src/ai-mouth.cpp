@@ -1,6 +1,7 @@
 #include "ai-mouth.hpp"
 
 #include <fmt/core.h>
+#include <random>
 #include <spdlog/spdlog.h>
 
 #include "audio-in.hpp"
@@ -48,6 +49,8 @@ AiMouth::AiMouth(Lib &aLib,
 
 AiMouth::~AiMouth()
 {
+  if (upload)
+    stt->cancel(*upload);
   wav2Visemes.get().unreg(*this);
   audioIn.get().unreg(*this);
   twitch->unreg(*this);
@@ -55,57 +58,62 @@ AiMouth::~AiMouth()
 
 auto AiMouth::do_clone() const -> std::shared_ptr<Node>
 {
-  return std::make_shared<AiMouth>(*this);
+  auto ret = std::make_shared<AiMouth>(*this);
+  // the utterance in flight belongs to the original
+  ret->upload.reset();
+  return ret;
 }
 
 auto AiMouth::ingest(Wav wav, bool /*overlap*/) -> void
 {
-  if (!visible)
+  if (!visible())
+  {
+    // a paused upload would hold a scheduler slot until the server times out
+    if (upload)
+    {
+      stt->cancel(*upload);
+      upload.reset();
+    }
     return;
-  wavBuf.insert(std::end(wavBuf), std::begin(wav), std::end(wav));
+  }
   using namespace std::chrono_literals;
-  if (std::chrono::high_resolution_clock::now() > silStart + 1000ms)
+  const auto sampleRate = audioIn.get().sampleRate();
+  const auto isSilent = std::chrono::high_resolution_clock::now() > silStart + 1000ms;
+  if (upload)
   {
-    const auto sampleRate = audioIn.get().sampleRate();
-    if (static_cast<int>(wavBuf.size()) > 1 * sampleRate)
+    // the utterance is uploaded while it is recorded, so only the tail is left to send when it ends
+    uploadLen += wav.size();
+    if (!wav.empty())
+      uploadMax = std::max(uploadMax, *std::max_element(std::begin(wav), std::end(wav)));
+    stt->feed(*upload, wav);
+    if (isSilent)
     {
-      auto max = std::max_element(std::begin(wavBuf), std::end(wavBuf));
-      if (*max > 0x2000 || static_cast<int>(wavBuf.size()) > 10 * sampleRate)
-        stt->perform(Wav{std::begin(wavBuf), std::end(wavBuf)},
-                     sampleRate,
-                     [alive = weak_self()](std::string_view txt) {
-                       if (auto self = alive.lock())
-                       {
-                         if (!self->hostMsg.empty())
-                           self->hostMsg += '\n';
-                         self->hostMsg += txt;
-                         SPDLOG_INFO("{}: {}", self->host, txt);
-                         if (self->hostMsg.size() < 75)
-                           return;
-
-                         self->lib.get().gpt().prompt(
-                           "Host", std::move(self->hostMsg), [alive](std::string_view rsp) {
-                             if (auto self = alive.lock())
-                             {
-                               SPDLOG_INFO("{}: {}", self->cohost, rsp);
-                               self->tts->say("en-US-AmberNeural", std::string(rsp), false);
-                               self->talkStart = std::chrono::high_resolution_clock::now();
-                             }
-                             else
-                             {
-                               SPDLOG_INFO("this was destroyed");
-                             };
-                           });
-                         self->hostMsg.clear();
-                       }
-                       else
-                       {
-                         SPDLOG_INFO("this was destroyed");
-                       }
-                     });
+      if (uploadMax > 0x2000 || static_cast<int>(uploadLen) > 10 * sampleRate)
+        stt->end(*upload);
+      else
+        stt->cancel(*upload);
+      upload.reset();
+    }
+  }
+  else
+  {
+    wavBuf.insert(std::end(wavBuf), std::begin(wav), std::end(wav));
+    if (!isSilent && static_cast<int>(wavBuf.size()) > 1 * sampleRate)
+    {
+      upload = stt->begin(sampleRate, [alive = weak_self()](std::string_view txt) {
+        if (auto self = alive.lock())
+          self->hear(txt);
+        else
+          SPDLOG_INFO("this was destroyed");
+      });
+      uploadLen = wavBuf.size();
+      uploadMax = *std::max_element(std::begin(wavBuf), std::end(wavBuf));
+      stt->feed(*upload, Wav{std::begin(wavBuf), std::end(wavBuf)});
+      wavBuf.clear();
     }
-    while (static_cast<int>(wavBuf.size()) > sampleRate / 5)
-      wavBuf.pop_front();
+    if (isSilent)
+      while (static_cast<int>(wavBuf.size()) > sampleRate / 5)
+        wavBuf.pop_front();
   }
   if (std::chrono::high_resolution_clock::now() > silStart + 5000ms && hostMsg.size() > 5)
   {
@@ -127,6 +135,32 @@ auto AiMouth::ingest(Wav wav, bool /*overlap*/) -> void
   }
 }
 
+auto AiMouth::hear(std::string_view txt) -> void
+{
+  if (!hostMsg.empty())
+    hostMsg += '\n';
+  hostMsg += txt;
+  SPDLOG_INFO("{}: {}", host, txt);
+  if (hostMsg.size() < 75)
+    return;
+
+  lib.get().gpt().prompt("Host", std::move(hostMsg), [alive = weak_self()](std::string_view rsp) {
+    if (auto self = alive.lock())
+    {
+      if (rsp.empty())
+        return;
+      SPDLOG_INFO("{}: {}", self->cohost, rsp);
+      self->tts->say("en-US-AmberNeural", std::string(rsp), false);
+      self->talkStart = std::chrono::high_resolution_clock::now();
+    }
+    else
+    {
+      SPDLOG_INFO("this was destroyed");
+    }
+  });
+  hostMsg.clear();
+}
+
 auto AiMouth::ingest(Viseme v) -> void
 {
   viseme = v;
@@ -148,14 +182,26 @@ auto AiMouth::load(IStrm &strm) -> void
   lib.get().gpt().cohost(cohost);
 }
 
-auto AiMouth::render(float dt, Node *hovered, Node *selected) -> void
+auto AiMouth::preload() const -> void
+{
+  sprite.preload(0);
+}
+
+auto AiMouth::tick(float /*dt*/) -> void
 {
   using namespace std::chrono_literals;
+  // rand() is not safe to call from the workers
+  thread_local auto rng = std::minstd_rand{std::random_device{}()};
   if (std::chrono::high_resolution_clock::now() < talkStart + 3s && sprite.numFrames() > 0)
-    sprite.frame(rand() % sprite.numFrames());
+    sprite.frame(static_cast<int>(rng() % static_cast<unsigned>(sprite.numFrames())));
   else
     sprite.frame(0);
-  sprite.render();
+}
+
+auto AiMouth::render(float dt, Node *hovered, Node *selected) -> void
+{
+  if (isOnScreen())
+    sprite.render();
   Node::render(dt, hovered, selected);
 }
 
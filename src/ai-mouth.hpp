@@ -1,9 +1,11 @@
 #pragma once
 #include "audio-sink.hpp"
+#include "azure-stt.hpp"
 #include "gpt.hpp"
 #include "node.hpp"
 #include "sprite-sheet.hpp"
 #include "visemes-sink.hpp"
+#include <optional>
 
 class AiMouth final : public AudioSink, public VisemesSink, public TwitchSink, public Node
 {
@@ -41,6 +43,9 @@ private:
   std::map<Viseme, int> viseme2Sprite;
   std::string voice;
   std::deque<int16_t> wavBuf;
+  std::optional<AzureStt::UploadId> upload;
+  size_t uploadLen = 0;
+  int16_t uploadMax = 0;
   std::chrono::high_resolution_clock::time_point silStart;
   std::string hostMsg;
   std::string systemPrompt;
@@ -48,13 +53,21 @@ private:
   std::string cohost = "Clara";
   std::chrono::high_resolution_clock::time_point talkStart;
 
+  auto actsWhileHidden() const -> bool final { return true; }
   auto h() const -> float final;
+  auto hear(std::string_view) -> void;
   auto ingest(Viseme) -> void final;
   auto ingest(Wav, bool overlap) -> void final;
   auto isTransparent(glm::vec2) const -> bool final;
   auto load(IStrm &) -> void final;
   auto onMsg(Msg) -> void final;
+  auto preload() const -> void final;
   auto render(float dt, Node *hovered, Node *selected) -> void final;
+  auto tick(float dt) -> void final;
+  auto textureRefs(std::vector<const std::shared_ptr<const Texture> *> &v) const -> void final
+  {
+    sprite.textureRefs(v);
+  }
   auto renderUi() -> void final;
   auto sampleRate() const -> int final;
   auto save(OStrm &) const -> void final;
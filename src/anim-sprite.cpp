@@ -9,31 +9,16 @@ AnimSprite::AnimSprite(Lib &lib, Undo &aUndo, const std::filesystem::path &path)
   : Node(lib, aUndo, path.filename().string()),
     sprite(lib, aUndo, path),
     startTime(std::chrono::high_resolution_clock::now()),
-    arrowN(lib.queryTex("engine:arrow-n-circle.png", true)),
-    arrowNE(lib.queryTex("engine:arrow-ne-circle.png", true)),
-    arrowE(lib.queryTex("engine:arrow-e-circle.png", true)),
-    arrowSE(lib.queryTex("engine:arrow-se-circle.png", true)),
-    arrowS(lib.queryTex("engine:arrow-s-circle.png", true)),
-    arrowSW(lib.queryTex("engine:arrow-sw-circle.png", true)),
-    arrowW(lib.queryTex("engine:arrow-w-circle.png", true)),
-    arrowNW(lib.queryTex("engine:arrow-nw-circle.png", true)),
-    center(lib.queryTex("engine:center-circle.png", true))
+    body(lib.physics())
 {
 }
 
-static auto getProjectionMatrix() -> glm::mat4
-{
-  GLfloat projectionMatrixData[16];
-  glGetFloatv(GL_PROJECTION_MATRIX, projectionMatrixData);
-  return glm::make_mat4(projectionMatrixData);
-}
-
 auto AnimSprite::do_clone() const -> std::shared_ptr<Node>
 {
   return std::make_shared<AnimSprite>(*this);
 }
 
-auto AnimSprite::render(float dt, Node *hovered, Node *selected) -> void
+auto AnimSprite::tick(float /*dt*/) -> void
 {
   if (sprite.numFrames() > 0)
     sprite.frame(static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(
@@ -41,34 +26,22 @@ auto AnimSprite::render(float dt, Node *hovered, Node *selected) -> void
                                     .count() *
                                   fps / 1'000'000) %
                  sprite.numFrames());
-  sprite.render();
-  Node::render(dt, hovered, selected);
-  if (dt <= 0.f)
-    return;
+}
 
-  const auto projMat = getProjectionMatrix();
-  const auto pivot4 = glm::vec4{pivot().x, pivot().y, 0.f, 1.f};
-  const auto projPivot = projMat * modelViewMat * pivot4;
-  const auto v = (glm::vec2{projPivot.x, projPivot.y} - lastProjPivot) / dt;
-  const auto gForce = glm::vec2{0.f, .3f};
-  const auto a = (v - lastProjPivotV) / dt + gForce;
-  lastProjPivot = glm::vec2{projPivot.x, projPivot.y};
-  lastProjPivotV = v;
+auto AnimSprite::render(float dt, Node *hovered, Node *selected) -> void
+{
+  sprite.prefetch(sprite.frame() + 1);
+  if (isOnScreen())
+    sprite.render();
+  Node::render(dt, hovered, selected);
+  // the simulation itself runs in Physics::step
+  body.sync(transformId(), Physics::Params{physics, end, force, damping, springiness});
   if (!physics)
     return;
 
   if (glm::length(end - pivot()) < 1.f)
     return;
 
-  const auto end4 = glm::vec4{end.x, end.y, 0.f, 1.f};
-  const auto projEnd = projMat * modelViewMat * end4;
-  const auto pivotToEnd = glm::vec2(projEnd) - glm::vec2(projPivot);
-  const auto orthogonalVec = glm::vec2{-pivotToEnd.y, pivotToEnd.x};
-  const auto normalizedOrthogonalVec = glm::normalize(orthogonalVec);
-  float projection = glm::dot(a, normalizedOrthogonalVec);
-  animRotV += (-force * projection - dRot * springiness - animRotV * damping) * dt;
-  dRot += animRotV * dt;
-
   if (selected != this)
     return;
   glColor4f(1.f, .7f, .0f, 1.f);
@@ -92,10 +65,10 @@ auto AnimSprite::renderUi() -> void
   ImGui::TableNextColumn();
   if (Ui::checkbox(undo, "##Physics", physics))
   {
-    animRotV = {};
-    dRot = {};
-    dLoc = {};
-    dScale = {};
+    body.reset();
+    dRot() = {};
+    dLoc() = {};
+    dScale() = {};
   }
 
   ImGui::TableNextColumn();
@@ -118,7 +91,7 @@ auto AnimSprite::renderUi() -> void
                   std::numeric_limits<float>::max(),
                   "%.1f");
     const auto sz = 2 * ImGui::GetFontSize();
-    if (Ui::btnImg("nw2", *arrowNW, sz, sz))
+    if (Ui::btnImg("nw2", icons.get()[Icon::arrowNW], sz, sz))
       undo.get().record(
         [newEnd = glm::vec2{0, h()}, alive = weak_self()]() {
           if (auto self = alive.lock())
@@ -141,7 +114,7 @@ auto AnimSprite::renderUi() -> void
           }
         });
     ImGui::SameLine();
-    if (Ui::btnImg("n2", *arrowN, sz, sz))
+    if (Ui::btnImg("n2", icons.get()[Icon::arrowN], sz, sz))
       undo.get().record(
         [newEnd = glm::vec2{w() / 2, h()}, alive = weak_self()]() {
           if (auto self = alive.lock())
@@ -164,7 +137,7 @@ auto AnimSprite::renderUi() -> void
           }
         });
     ImGui::SameLine();
-    if (Ui::btnImg("ne2", *arrowNE, sz, sz))
+    if (Ui::btnImg("ne2", icons.get()[Icon::arrowNE], sz, sz))
       undo.get().record(
         [newEnd = glm::vec2{w(), h()}, alive = weak_self()]() {
           if (auto self = alive.lock())
@@ -186,7 +159,7 @@ auto AnimSprite::renderUi() -> void
             SPDLOG_INFO("this was destroyed");
           }
         });
-    if (Ui::btnImg("w2", *arrowW, sz, sz))
+    if (Ui::btnImg("w2", icons.get()[Icon::arrowW], sz, sz))
       undo.get().record(
         [newEnd = glm::vec2{0, h() / 2}, alive = weak_self()]() {
           if (auto self = alive.lock())
@@ -209,7 +182,7 @@ auto AnimSprite::renderUi() -> void
           }
         });
     ImGui::SameLine();
-    if (Ui::btnImg("c2", *center, sz, sz))
+    if (Ui::btnImg("c2", icons.get()[Icon::center], sz, sz))
       undo.get().record(
         [newEnd = glm::vec2{w() / 2, h() / 2}, alive = weak_self()]() {
           if (auto self = alive.lock())
@@ -232,7 +205,7 @@ auto AnimSprite::renderUi() -> void
           }
         });
     ImGui::SameLine();
-    if (Ui::btnImg("e2", *arrowE, sz, sz))
+    if (Ui::btnImg("e2", icons.get()[Icon::arrowE], sz, sz))
       undo.get().record(
         [newEnd = glm::vec2{w(), h() / 2}, alive = weak_self()]() {
           if (auto self = alive.lock())
@@ -254,7 +227,7 @@ auto AnimSprite::renderUi() -> void
             SPDLOG_INFO("this was destroyed");
           }
         });
-    if (Ui::btnImg("sw2", *arrowSW, sz, sz))
+    if (Ui::btnImg("sw2", icons.get()[Icon::arrowSW], sz, sz))
       undo.get().record(
         [newEnd = glm::vec2{0, 0}, alive = weak_self()]() {
           if (auto self = alive.lock())
@@ -277,7 +250,7 @@ auto AnimSprite::renderUi() -> void
           }
         });
     ImGui::SameLine();
-    if (Ui::btnImg("s2", *arrowS, sz, sz))
+    if (Ui::btnImg("s2", icons.get()[Icon::arrowS], sz, sz))
       undo.get().record(
         [newEnd = glm::vec2{w() / 2, 0}, alive = weak_self()]() {
           if (auto self = alive.lock())
@@ -300,7 +273,7 @@ auto AnimSprite::renderUi() -> void
           }
         });
     ImGui::SameLine();
-    if (Ui::btnImg("se2", *arrowSE, sz, sz))
+    if (Ui::btnImg("se2", icons.get()[Icon::arrowSE], sz, sz))
       undo.get().record(
         [newEnd = glm::vec2{w(), 0}, alive = weak_self()]() {
           if (auto self = alive.lock())
@@ -384,6 +357,11 @@ auto AnimSprite::isTransparent(glm::vec2 v) const -> bool
   return sprite.isTransparent(v);
 }
 
+auto AnimSprite::preload() const -> void
+{
+  sprite.preload(sprite.frame());
+}
+
 auto AnimSprite::w() const -> float
 {
   return sprite.w();
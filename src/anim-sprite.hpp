@@ -22,6 +22,7 @@ public:
 
 protected:
   auto render(float dt, Node *hovered, Node *selected) -> void override;
+  auto tick(float dt) -> void override;
   auto save(OStrm &) const -> void override;
   auto load(IStrm &) -> void override;
   auto renderUi() -> void override;
@@ -37,21 +38,15 @@ private:
   float damping = 1.f;
   float springiness = 2.f;
   std::chrono::high_resolution_clock::time_point startTime;
-  float animRotV = 0.f;
-  glm::vec2 lastProjPivot = {0.f, 0.f};
-  glm::vec2 lastProjPivotV = {0.f, 0.f};
-  std::shared_ptr<const Texture> arrowN;
-  std::shared_ptr<const Texture> arrowNE;
-  std::shared_ptr<const Texture> arrowE;
-  std::shared_ptr<const Texture> arrowSE;
-  std::shared_ptr<const Texture> arrowS;
-  std::shared_ptr<const Texture> arrowSW;
-  std::shared_ptr<const Texture> arrowW;
-  std::shared_ptr<const Texture> arrowNW;
-  std::shared_ptr<const Texture> center;
+  Physics::Body body;
 
   auto h() const -> float final;
   auto isTransparent(glm::vec2) const -> bool final;
+  auto preload() const -> void final;
+  auto textureRefs(std::vector<const std::shared_ptr<const Texture> *> &v) const -> void final
+  {
+    sprite.textureRefs(v);
+  }
   auto w() const -> float final;
   auto do_clone() const -> std::shared_ptr<Node>;
 };
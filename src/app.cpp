@@ -10,6 +10,7 @@
 #include "eye-v2.hpp"
 #include "eye.hpp"
 #include "file-open.hpp"
+#include "file.hpp"
 #include "imgui-helpers.hpp"
 #include "input-dialog.hpp"
 #include "message-dialog.hpp"
@@ -17,16 +18,33 @@
 #include "preferences-dialog.hpp"
 #include "prj-dialog.hpp"
 #include "root.hpp"
+#include "texture-cache.hpp"
+#include "trace.hpp"
 #include "ui.hpp"
 #include "version.hpp"
 
 #include <imgui_impl_opengl3.h>
 #include <imgui_impl_sdl2.h>
 #include <SDL_opengl.h>
+#include <cstring>
+#include <ctime>
 #include <fmt/std.h>
-#include <fstream>
 #include <spdlog/spdlog.h>
 
+// projects saved before the chunked format are one flat stream starting with this version
+static constexpr auto LegacySaveVersion = uint32_t{2};
+
+static const auto startupTime = std::chrono::steady_clock::now();
+
+static auto logStartup(std::string_view phase) -> void
+{
+  SPDLOG_INFO("startup: {} at {} ms",
+              phase,
+              std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                    startupTime)
+                .count());
+}
+
 static auto getProjMat() -> glm::mat4
 {
   GLfloat projMatData[16];
@@ -38,27 +56,20 @@ App::App(sdl::Window &aWindow, int argc, char *argv[])
   : window(aWindow),
     gl_context(SDL_GL_CreateContext(window.get().get())),
     lastUpdate(std::chrono::high_resolution_clock::now()),
-    audioOut(preferences.audioOut),
-    audioIn(uv, preferences.audioIn, wav2Visemes.sampleRate(), wav2Visemes.frameSize()),
+    jobs(uv),
+    wav2Visemes(jobs,
+                [this]() {
+                  audioIn.reg(wav2Visemes);
+                  logStartup("speech model ready");
+                }),
+    audioIn(uv, wav2Visemes.sampleRate(), wav2Visemes.frameSize()),
     mouseTracking(uv),
     httpClient(uv),
-    lib(preferences, uv, httpClient),
-    selectIco(lib.queryTex("engine:select.png", true)),
-    translateIco(lib.queryTex("engine:transalte.png", true)),
-    scaleIco(lib.queryTex("engine:scale.png", true)),
-    rotateIco(lib.queryTex("engine:rotate.png", true)),
-    selectDisabledIco(lib.queryTex("engine:select-disabled.png", true)),
-    translateDisabledIco(lib.queryTex("engine:transalte-disabled.png", true)),
-    scaleDisabledIco(lib.queryTex("engine:scale-disabled.png", true)),
-    rotateDisabledIco(lib.queryTex("engine:rotate-disabled.png", true)),
-    hideIco(lib.queryTex("engine:eye-sprite.png", true)),
-    showIco(lib.queryTex("engine:not-visable.png", true)),
-    arrowN(lib.queryTex("engine:arrow-n-circle.png", true)),
-    arrowE(lib.queryTex("engine:arrow-e-circle.png", true)),
-    arrowS(lib.queryTex("engine:arrow-s-circle.png", true)),
-    arrowW(lib.queryTex("engine:arrow-w-circle.png", true)),
+    lib(preferences, uv, jobs, httpClient),
     renderTimer(uv.createTimer()),
-    renderIdle(uv.createIdle())
+    renderIdle(uv.createIdle()),
+    autosaveTimer(uv.createTimer()),
+    lastAutosave(std::chrono::steady_clock::now())
 {
   SDL_GL_MakeCurrent(window.get().get(), gl_context);
   SDL_GL_SetSwapInterval(preferences.vsync ? 1 : 0);
@@ -91,6 +102,7 @@ App::App(sdl::Window &aWindow, int argc, char *argv[])
   // Setup Platform/Renderer backends
   ImGui_ImplSDL2_InitForOpenGL(window.get().get(), gl_context);
   ImGui_ImplOpenGL3_Init(glsl_version);
+  logStartup("renderer initialized");
 
   auto &io = ImGui::GetIO();
   // Load Fonts
@@ -121,7 +133,6 @@ App::App(sdl::Window &aWindow, int argc, char *argv[])
 
   SPDLOG_INFO("sample rate: {}", wav2Visemes.sampleRate());
   SPDLOG_INFO("frame rate: {}", wav2Visemes.frameSize());
-  audioIn.reg(wav2Visemes);
   saveFactory.reg<Bouncer>(
     [this](std::string) { return std::make_unique<Bouncer>(lib, undo, audioIn); });
   saveFactory.reg<Bouncer2>([this](std::string name) {
@@ -161,12 +172,19 @@ App::App(sdl::Window &aWindow, int argc, char *argv[])
     std::filesystem::current_path(argv[1]);
     showUi = false;
     loadPrj();
+    logStartup("project loaded");
   }
+  undo.setBudget(static_cast<size_t>(preferences.undoHistoryMb) * 1024 * 1024);
+  TextureCache::setBudget(static_cast<size_t>(preferences.textureCacheMb) * 1024 * 1024);
+  jobs.submit([]() { TextureCache::prune(); });
   setupRendering();
+  autosaveTimer.start([this]() { autosave(); }, 1'000, 1'000);
 }
 
 auto App::render(float dt) -> void
 {
+  TRACE_ZONE("App::render");
+  lib.updateResidency();
   if (!root)
   {
     glClearColor(0x45 / 255.f, 0x44 / 255.f, 0x7d / 255.f, 1.f);
@@ -174,6 +192,9 @@ auto App::render(float dt) -> void
     return;
   }
 
+  root->tickAll(dt, jobs);
+  lib.physics().step(dt, getProjMat());
+
   if (showUi && !isMinimized)
   {
     root->renderAll(dt, hovered, selected);
@@ -270,6 +291,7 @@ auto App::render(float dt) -> void
 
 auto App::renderUi(float /*dt*/) -> void
 {
+  TRACE_ZONE("App::renderUi");
   if (!root)
   {
     if (!dialog)
@@ -289,7 +311,7 @@ auto App::renderUi(float /*dt*/) -> void
       style.Colors[ImGuiCol_WindowBg].w = .2f;
     auto showUiWindow = Ui::Window("##Show UI");
     const auto sz = 2 * ImGui::GetFontSize();
-    if (Ui::btnImg("Show UI (U)", *showIco, sz, sz))
+    if (Ui::btnImg("Show UI (U)", lib.icons()[Icon::show], sz, sz))
       showUi = true;
     if (ImGui::IsItemHovered())
       ImGui::SetTooltip("Show UI (U)");
@@ -384,8 +406,8 @@ auto App::renderUi(float /*dt*/) -> void
         auto delDisabled = Ui::Disabled(!selected);
         if (ImGui::MenuItem("Toggle Visiblity", "H"))
           if (selected)
-            undo.record([isVisible = selected->visible, this]() { selected->visible = !isVisible; },
-                        [isVisible = selected->visible, this]() { selected->visible = isVisible; });
+            undo.record([isVisible = selected->visible(), this]() { selected->visible() = !isVisible; },
+                        [isVisible = selected->visible(), this]() { selected->visible() = isVisible; });
       }
       {
         auto delDisabled = Ui::Disabled(!selected);
@@ -399,6 +421,9 @@ auto App::renderUi(float /*dt*/) -> void
           if (!r)
             return;
           lib.flush();
+          undo.setBudget(static_cast<size_t>(preferences.undoHistoryMb) * 1024 * 1024);
+          TextureCache::setBudget(static_cast<size_t>(preferences.textureCacheMb) * 1024 * 1024);
+          jobs.submit([]() { TextureCache::prune(); });
           setupRendering();
         });
     }
@@ -412,30 +437,30 @@ auto App::renderUi(float /*dt*/) -> void
     {
       {
         const auto sz = 2 * ImGui::GetFontSize();
-        if (Ui::btnImg("Hide UI (U)", *hideIco, sz, sz))
+        if (Ui::btnImg("Hide UI (U)", lib.icons()[Icon::hide], sz, sz))
           showUi = false;
         if (ImGui::IsItemHovered())
           ImGui::SetTooltip("Hide UI (U)");
         ImGui::SameLine();
-        if (Ui::btnImg("Select", editMode == EditMode::select ? *selectIco : *selectDisabledIco, sz, sz))
+        if (Ui::btnImg("Select", editMode == EditMode::select ? lib.icons()[Icon::select] : lib.icons()[Icon::selectDisabled], sz, sz))
           editMode = EditMode::select;
         if (ImGui::IsItemHovered())
           ImGui::SetTooltip("Select (Shift+Q)");
         ImGui::SameLine();
         if (Ui::btnImg("Translate",
-                       editMode == EditMode::translate ? *translateIco : *translateDisabledIco,
+                       editMode == EditMode::translate ? lib.icons()[Icon::translate] : lib.icons()[Icon::translateDisabled],
                        sz,
                        sz))
           editMode = EditMode::translate;
         if (ImGui::IsItemHovered())
           ImGui::SetTooltip("Translate (Shift+W)");
         ImGui::SameLine();
-        if (Ui::btnImg("Rotate", editMode == EditMode::rotate ? *rotateIco : *rotateDisabledIco, sz, sz))
+        if (Ui::btnImg("Rotate", editMode == EditMode::rotate ? lib.icons()[Icon::rotate] : lib.icons()[Icon::rotateDisabled], sz, sz))
           editMode = EditMode::rotate;
         if (ImGui::IsItemHovered())
           ImGui::SetTooltip("Rotate (Shift+E)");
         ImGui::SameLine();
-        if (Ui::btnImg("Scale", editMode == EditMode::scale ? *scaleIco : *scaleDisabledIco, sz, sz))
+        if (Ui::btnImg("Scale", editMode == EditMode::scale ? lib.icons()[Icon::scale] : lib.icons()[Icon::scaleDisabled], sz, sz))
           editMode = EditMode::scale;
         if (ImGui::IsItemHovered())
           ImGui::SetTooltip("Scale (Shift+R)");
@@ -443,28 +468,41 @@ auto App::renderUi(float /*dt*/) -> void
 
       auto hierarchyButtonsDisabled = Ui::Disabled(!selected);
       const auto sz = ImGui::GetFontSize();
-      if (Ui::btnImg("<", *arrowW, sz, sz))
+      if (Ui::btnImg("<", lib.icons()[Icon::arrowW], sz, sz))
         selected->unparent();
       if (ImGui::IsItemHovered())
         ImGui::SetTooltip("Unparent");
       ImGui::SameLine();
-      if (Ui::btnImg("^", *arrowN, sz, sz))
+      if (Ui::btnImg("^", lib.icons()[Icon::arrowN], sz, sz))
         selected->moveUp();
       if (ImGui::IsItemHovered())
         ImGui::SetTooltip("Move up");
       ImGui::SameLine();
-      if (Ui::btnImg("V", *arrowS, sz, sz))
+      if (Ui::btnImg("V", lib.icons()[Icon::arrowS], sz, sz))
         selected->moveDown();
       if (ImGui::IsItemHovered())
         ImGui::SetTooltip("Move down");
       ImGui::SameLine();
-      if (Ui::btnImg(">", *arrowE, sz, sz))
+      if (Ui::btnImg(">", lib.icons()[Icon::arrowE], sz, sz))
         selected->parentWithBellow();
       if (ImGui::IsItemHovered())
         ImGui::SetTooltip("Parent with below");
     }
     renderTree(*root);
     ImGui::TextF("{:3f} ms/frame ({:1f} FPS)", 1000.0f / io.Framerate, io.Framerate);
+    if (!wav2Visemes.isReady())
+      ImGui::TextUnformatted("Loading the speech model...");
+    const auto &jobsStats = jobs.stats();
+    for (auto i = 0U; i < jobsStats.size(); ++i)
+      ImGui::TextF("Worker {}: {:.0f}% busy, {} jobs", i, 100.f * jobsStats[i].utilization, jobsStats[i].jobs);
+    if (const auto &httpStats = httpClient.stats(); httpStats.requests > 0)
+    {
+      const auto newConnections = httpStats.requests - httpStats.reused;
+      ImGui::TextF("HTTP: {} requests, {} reused connections, {:.0f} ms avg handshake",
+                   httpStats.requests,
+                   httpStats.reused,
+                   newConnections > 0 ? httpStats.handshakeUs / 1000.f / static_cast<float>(newConnections) : 0.f);
+    }
   }
   {
     auto detailsWindow = Ui::Window("Details");
@@ -475,8 +513,15 @@ auto App::renderUi(float /*dt*/) -> void
         ImGui::TableSetupColumn("Value", ImGuiTableColumnFlags_WidthStretch);
         ImGui::TableHeadersRow();
         selected->renderUi();
+        // not every property goes through undo
+        if (ImGui::IsAnyItemActive())
+        {
+          selected->markDirty();
+          isDirty = true;
+        }
       }
   }
+  trackChanges();
   for (auto &action : postponedActions)
     action();
   postponedActions.clear();
@@ -581,8 +626,8 @@ auto App::processIo() -> void
       if (ImGui::IsKeyPressed(ImGuiKey_X) || ImGui::IsKeyPressed(ImGuiKey_Delete))
         Node::del(&selected);
       if (ImGui::IsKeyPressed(ImGuiKey_H))
-        undo.record([isVisible = selected->visible, this]() { selected->visible = !isVisible; },
-                    [isVisible = selected->visible, this]() { selected->visible = isVisible; });
+        undo.record([isVisible = selected->visible(), this]() { selected->visible() = !isVisible; },
+                    [isVisible = selected->visible(), this]() { selected->visible() = isVisible; });
       if (ImGui::IsKeyPressed(ImGuiKey_U))
         showUi = !showUi;
       if (ImGui::IsKeyPressed(ImGuiKey_D))
@@ -590,6 +635,7 @@ auto App::processIo() -> void
         if (selected)
         {
           auto n = selected->clone();
+          const auto pinnedBytes = n->subtreeTextureBytes();
           undo.record(
             [n, parent = selected->parent(), this]() {
               selected = n.get();
@@ -598,7 +644,9 @@ auto App::processIo() -> void
             [n, oldSelected = selected, this]() {
               Node::delNoUndo(*n);
               selected = oldSelected;
-            });
+            },
+            "",
+            pinnedBytes);
           int mouseX, mouseY;
           SDL_GetMouseState(&mouseX, &mouseY);
           selected->translateStart(glm::vec2{1.f * mouseX, 1.f * mouseY});
@@ -628,6 +676,22 @@ auto App::processIo() -> void
     undo.undo();
   if (io.KeyCtrl && !io.KeyShift && !io.KeyAlt && !io.KeySuper && ImGui::IsKeyPressed(ImGuiKey_Y))
     undo.redo();
+  if (ImGui::IsKeyPressed(ImGuiKey_F12, false))
+    dumpTrace();
+}
+
+auto App::dumpTrace() -> void
+{
+  const auto t = std::time(nullptr);
+  auto tm = std::tm{};
+#ifdef _WIN32
+  localtime_s(&tm, &t);
+#else
+  localtime_r(&t, &tm);
+#endif
+  char name[64];
+  std::strftime(name, sizeof(name), "trace-%Y%m%d-%H%M%S.json", &tm);
+  Trace::dump(name);
 }
 
 auto App::cancel() -> void
@@ -689,14 +753,16 @@ auto App::renderTree(Node &v) -> void
   const auto &nodes = v.getNodes();
   const auto sz = ImGui::GetFontSize();
   auto const label = fmt::format("##{}", static_cast<void *>(&v));
-  if (!nodes.empty())
+  if (!nodes.empty() || v.hasLazyChildren())
   {
-    if (Ui::btnImg(label, v.visible ? *hideIco : *showIco, sz, sz))
-      undo.record([&v, newVisibility = !v.visible]() { v.visible = newVisibility; },
-                  [&v, oldVisibility = v.visible]() { v.visible = oldVisibility; });
+    if (Ui::btnImg(label, v.visible() ? lib.icons()[Icon::hide] : lib.icons()[Icon::show], sz, sz))
+      undo.record([&v, newVisibility = !v.visible()]() { v.visible() = newVisibility; },
+                  [&v, oldVisibility = v.visible()]() { v.visible() = oldVisibility; });
 
     ImGui::SameLine();
-    nodeFlags |= ImGuiTreeNodeFlags_DefaultOpen;
+    // opening a node with serialized children loads them
+    if (!v.hasLazyChildren())
+      nodeFlags |= ImGuiTreeNodeFlags_DefaultOpen;
     const auto nodeOpen = ImGui::TreeNodeEx(&v, nodeFlags, "%s", nm.c_str());
     if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen())
       undo.record([&v, this]() { selected = &v; },
@@ -704,6 +770,7 @@ auto App::renderTree(Node &v) -> void
     dragAndDrop();
     if (nodeOpen)
     {
+      v.loadLazy();
       for (const auto &n : nodes)
         renderTree(*n);
       ImGui::TreePop();
@@ -711,9 +778,9 @@ auto App::renderTree(Node &v) -> void
   }
   else
   {
-    if (Ui::btnImg(label, v.visible ? *hideIco : *showIco, sz, sz))
-      undo.record([&v, newVisibility = !v.visible]() { v.visible = newVisibility; },
-                  [&v, oldVisibility = v.visible]() { v.visible = oldVisibility; });
+    if (Ui::btnImg(label, v.visible() ? lib.icons()[Icon::hide] : lib.icons()[Icon::show], sz, sz))
+      undo.record([&v, newVisibility = !v.visible()]() { v.visible() = newVisibility; },
+                  [&v, oldVisibility = v.visible()]() { v.visible() = oldVisibility; });
     ImGui::SameLine();
     nodeFlags |=
       ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen; // ImGuiTreeNodeFlags_Bullet
@@ -727,29 +794,46 @@ auto App::renderTree(Node &v) -> void
 
 auto App::loadPrj() -> void
 {
+  TRACE_ZONE("App::loadPrj");
   ImGui::LoadIniSettingsFromDisk("imgui.ini");
 
-  std::ifstream st("prj.tpp", std::ofstream::binary);
-  if (!st)
+  // deserialize straight from the mapping instead of copying the file around
+  auto file = MappedFile{"prj.tpp"};
+  if (!file)
   {
     root = std::make_unique<Root>(lib, undo);
     SPDLOG_INFO("Create new project");
     return;
   }
 
-  std::ostringstream buffer;
-  buffer << st.rdbuf();
-
-  auto buf = buffer.str();
+  if (Prj::isChunked(file.data(), file.data() + file.size()))
+  {
+    try
+    {
+      auto reader = Prj::Reader{file.data(), file.data() + file.size()};
+      reader.verify(jobs);
+      root = Node::loadAll(saveFactory, reader, nullptr);
+    }
+    catch (std::runtime_error &e)
+    {
+      SPDLOG_ERROR("{:t}", e);
+    }
+    if (!root)
+    {
+      SPDLOG_INFO("Create new project");
+      root = std::make_unique<Root>(lib, undo);
+    }
+    return;
+  }
 
-  IStrm strm(buf.data(), buf.data() + buf.size());
+  IStrm strm(file.data(), file.data() + file.size());
 
   uint32_t v;
   ::deser(strm, v);
-  if (v != saveVersion())
+  if (v != LegacySaveVersion)
   {
     root = std::make_unique<Root>(lib, undo);
-    SPDLOG_INFO("Version mismatch expected: {} received: {}", saveVersion(), v);
+    SPDLOG_INFO("Version mismatch expected: {} received: {}", LegacySaveVersion, v);
     return;
   }
 
@@ -766,11 +850,74 @@ auto App::savePrj() -> void
 {
   if (!root)
     return;
-  OStrm strm;
-  ::ser(strm, saveVersion());
-  root->saveAll(strm);
-  std::ofstream st("prj.tpp", std::ofstream::binary);
-  st.write(strm.str().data(), strm.str().size());
+  TRACE_ZONE("App::savePrj");
+  // an autosave still in flight would rename its older snapshot over this one
+  {
+    auto lock = std::unique_lock{saveMutex};
+    saveDone.wait(lock, [this]() { return !isSaving; });
+  }
+  trackChanges();
+  auto writer = Prj::Writer{};
+  root->saveAll(writer);
+  if (!replace_file("prj.tpp", writer.str()))
+    SPDLOG_ERROR("Failed to save the project: {}", strerror(errno));
+  isDirty = false;
+}
+
+auto App::trackChanges() -> void
+{
+  if (!root)
+    return;
+  if (undo.historyGeneration() != seenHistoryGeneration)
+    root->markDirtyAll();
+  else if (undo.generation() != seenGeneration && selected)
+    // edits recorded in undo come from the details of the selected node
+    selected->markDirty();
+  if (undo.generation() != seenGeneration)
+    isDirty = true;
+  seenGeneration = undo.generation();
+  seenHistoryGeneration = undo.historyGeneration();
+}
+
+auto App::autosave() -> void
+{
+  const auto period = std::chrono::seconds{preferences.autosaveSec};
+  if (!root || period.count() <= 0 || isSaving)
+    return;
+  const auto now = std::chrono::steady_clock::now();
+  if (now - lastAutosave < period)
+    return;
+  lastAutosave = now;
+  trackChanges();
+  if (!isDirty)
+    return;
+  isDirty = false;
+
+  // only the nodes changed since the last save are serialized here, assembling the file and the
+  // disk I/O happen on a worker
+  auto writer = Prj::Writer{};
+  {
+    TRACE_ZONE("App::autosave");
+    root->saveAll(writer);
+  }
+  isSaving = true;
+  auto ok = std::make_shared<bool>(false);
+  jobs.submit(
+    [writer = std::move(writer), ok, this]() {
+      TRACE_ZONE("App::autosave write");
+      *ok = replace_file("prj.tpp", writer.str());
+      {
+        auto lock = std::lock_guard{saveMutex};
+        isSaving = false;
+      }
+      saveDone.notify_all();
+    },
+    [ok, this]() {
+      if (*ok)
+        return;
+      SPDLOG_ERROR("Autosave failed");
+      isDirty = true;
+    });
 }
 
 auto App::addNode(const std::string &class_, const std::string &name) -> void
@@ -821,6 +968,8 @@ auto App::tick() -> void
 App::~App()
 {
   savePrj();
+  // staged texture uploads hold PBOs until their continuations run
+  jobs.drain();
 
   // Cleanup
   ImGui_ImplOpenGL3_Shutdown();
@@ -831,6 +980,7 @@ App::~App()
 
 auto App::sdlEventsAndRender() -> void
 {
+  TRACE_ZONE("App::sdlEventsAndRender");
   // Poll and handle events (inputs, window resize, etc.)
   // You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to tell if dear imgui wants
   // to use your inputs.
@@ -948,10 +1098,41 @@ auto App::sdlEventsAndRender() -> void
     SDL_GL_MakeCurrent(backup_current_window, backup_current_context);
   }
 
-  window.get().glSwap();
+  {
+    TRACE_ZONE("glSwap");
+    window.get().glSwap();
+  }
+  if (!isAudioOpen)
+  {
+    // the devices take a while to open, show the first frame before that
+    isAudioOpen = true;
+    logStartup("first frame");
+    openAudio();
+  }
   processIo();
 }
 
+auto App::openAudio() -> void
+{
+  try
+  {
+    audioOut.updateDevice(preferences.audioOut);
+  }
+  catch (const std::runtime_error &e)
+  {
+    SPDLOG_ERROR("{:t}", e);
+  }
+  try
+  {
+    audioIn.updateDevice(preferences.audioIn);
+  }
+  catch (const std::runtime_error &e)
+  {
+    SPDLOG_ERROR("{:t}", e);
+  }
+  logStartup("audio devices opened");
+}
+
 auto App::setupRendering() -> void
 {
   renderTimer.stop();
@@ -4,6 +4,7 @@
 #include "azure-tts.hpp"
 #include "dialog.hpp"
 #include "http-client.hpp"
+#include "jobs.hpp"
 #include "lib.hpp"
 #include "mouse-tracking.hpp"
 #include "preferences.hpp"
@@ -12,11 +13,14 @@
 #include "undo.hpp"
 #include "uv.hpp"
 #include "wav-2-visemes.hpp"
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui.h>
 #include <memory>
+#include <mutex>
 
 class App
 {
@@ -34,6 +38,7 @@ private:
   std::chrono::high_resolution_clock::time_point lastUpdate;
   bool isMinimized = false;
   uv::Uv uv;
+  Jobs jobs;
   Preferences preferences;
   SaveFactory saveFactory;
   Wav2Visemes wav2Visemes;
@@ -51,29 +56,28 @@ private:
   bool showUi = true;
   std::vector<std::function<auto()->void>> postponedActions;
   EditMode editMode = EditMode::select;
-  std::shared_ptr<const Texture> selectIco;
-  std::shared_ptr<const Texture> translateIco;
-  std::shared_ptr<const Texture> scaleIco;
-  std::shared_ptr<const Texture> rotateIco;
-  std::shared_ptr<const Texture> selectDisabledIco;
-  std::shared_ptr<const Texture> translateDisabledIco;
-  std::shared_ptr<const Texture> scaleDisabledIco;
-  std::shared_ptr<const Texture> rotateDisabledIco;
-  std::shared_ptr<const Texture> hideIco;
-  std::shared_ptr<const Texture> showIco;
-  std::shared_ptr<const Texture> arrowN;
-  std::shared_ptr<const Texture> arrowE;
-  std::shared_ptr<const Texture> arrowS;
-  std::shared_ptr<const Texture> arrowW;
   int originalX, originalY;
   int width, height;
   uv::Timer renderTimer;
   uv::Idle renderIdle;
+  uv::Timer autosaveTimer;
+  std::chrono::steady_clock::time_point lastAutosave;
+  bool isDirty = false;
+  std::atomic<bool> isSaving = false;
+  // signaled by the autosave job when it is done with the file
+  std::mutex saveMutex;
+  std::condition_variable saveDone;
+  uint64_t seenGeneration = 0;
+  uint64_t seenHistoryGeneration = 0;
+  bool isAudioOpen = false;
 
   auto addNode(const std::string &class_, const std::string &name) -> void;
+  auto autosave() -> void;
   auto cancel() -> void;
   auto droppedFile(std::string) -> void;
+  auto dumpTrace() -> void;
   auto loadPrj() -> void;
+  auto openAudio() -> void;
   auto processIo() -> void;
   auto render(float dt) -> void;
   auto renderTree(Node &) -> void;
@@ -81,4 +85,5 @@ private:
   auto savePrj() -> void;
   auto sdlEventsAndRender() -> void;
   auto setupRendering() -> void;
+  auto trackChanges() -> void;
 };
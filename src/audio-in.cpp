@@ -4,7 +4,7 @@
 
 #include "preferences.hpp"
 
-AudioIn::AudioIn(uv::Uv &uv, const std::string &device, int sampleRate, int frameSize)
+AudioIn::AudioIn(uv::Uv &uv, int sampleRate, int frameSize)
   : prepare(uv.createPrepare()),
     want([sampleRate, frameSize]() {
       SDL_AudioSpec ret;
@@ -14,15 +14,15 @@ AudioIn::AudioIn(uv::Uv &uv, const std::string &device, int sampleRate, int fram
       ret.channels = 1;
       ret.samples = static_cast<Uint16>(frameSize);
       return ret;
-    }()),
-    audio(makeDevice(device))
+    }())
 {
-
   prepare.start(std::bind_front(&AudioIn::tick, this));
 }
 
 auto AudioIn::tick() -> void
 {
+  if (!audio)
+    return;
   audio->lock();
   auto v = std::move(buf);
   buf.clear();
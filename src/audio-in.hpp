@@ -11,7 +11,8 @@
 class AudioIn : public virtual enable_shared_from_this
 {
 public:
-  AudioIn(uv::Uv &, const std::string &device, int sampleRate, int frameSize);
+  // the device is not opened until updateDevice() is called
+  AudioIn(uv::Uv &, int sampleRate, int frameSize);
   AudioIn(AudioIn const &) = delete;
   AudioIn(AudioIn &&) = delete;
 
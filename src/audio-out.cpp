@@ -7,7 +7,7 @@
 
 #include "preferences.hpp"
 
-AudioOut::AudioOut(const std::string &device, int sampleRate, int frameSize)
+AudioOut::AudioOut(int sampleRate, int frameSize)
   : want([sampleRate, frameSize]() {
       SDL_AudioSpec ret;
       SDL_zero(ret);
@@ -16,8 +16,7 @@ AudioOut::AudioOut(const std::string &device, int sampleRate, int frameSize)
       ret.channels = 1;
       ret.samples = static_cast<Uint16>(frameSize);
       return ret;
-    }()),
-    audio(makeDevice(device))
+    }())
 {
 }
 
@@ -29,6 +28,8 @@ auto AudioOut::updateDevice(const std::string &device) -> void
 
 auto AudioOut::ingest(Wav v, bool overlap) -> void
 {
+  if (!audio)
+    return;
   audio->lock();
   if (overlap)
     for (auto i = 0U; i < v.size(); ++i)
@@ -11,7 +11,8 @@
 class AudioOut final : public AudioSink, public virtual enable_shared_from_this
 {
 public:
-  AudioOut(const std::string &device, int sampleRate = 44100, int frameSize = 1024);
+  // the device is not opened until updateDevice() is called, samples ingested before that are dropped
+  AudioOut(int sampleRate = 44100, int frameSize = 1024);
   AudioOut(AudioOut const &) = delete;
   AudioOut(AudioOut &&) = delete;
 
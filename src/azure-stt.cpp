@@ -1,7 +1,6 @@
 #include "azure-stt.hpp"
 
 #include <cmath>
-#include <sstream>
 
 #include <fmt/std.h>
 #include <rapidjson/document.h>
@@ -11,146 +10,185 @@
 #include "http-client.hpp"
 #include "save-wav.hpp"
 
+// utterances are short, a second one can be in flight while the first is recognized
+static constexpr auto MaxInFlight = 2U;
+static constexpr auto MaxPerSec = 2.f;
+
 AzureStt::AzureStt(uv::Uv &uv, AzureToken &aToken, HttpClient &aHttpClient)
-  : timer(uv.createTimer()), token(aToken), httpClient(aHttpClient)
+  : token(aToken), httpClient(aHttpClient), scheduler(uv, MaxInFlight, MaxPerSec)
 {
-  process();
 }
 
-auto AzureStt::process() -> void
+auto AzureStt::perform(Wav wav, int sampleRate, Callback cb) -> void
 {
-  if (state == State::waiting)
-    return;
-  if (queue.empty())
-  {
-    state = State::idle;
-    return;
-  }
-  state = State::waiting;
-  token.get().get([alive = weak_self()](const std::string &t, const std::string &err) {
-    if (auto self = alive.lock())
-    {
-      if (t.empty())
+  const auto id = begin(sampleRate, std::move(cb));
+  feed(id, wav);
+  end(id);
+}
+
+auto AzureStt::begin(int sampleRate, Callback cb) -> UploadId
+{
+  auto upload = std::make_shared<Upload>();
+  upload->cb = std::move(cb);
+  upload->sampleRate = sampleRate;
+  upload->body = wavHeader(sampleRate, WavStreamSize);
+  const auto id = nextId++;
+  uploads.emplace(id, upload);
+  scheduler.push(
+    [upload, alive = weak_self()](Finish finish) mutable {
+      if (auto self = alive.lock())
       {
-        self->lastError = err;
-        self->timer.start([alive]() {
-          if (auto self = alive.lock())
-          {
-            self->state = State::idle;
-            self->process();
-          }
-          else
-          {
-            SPDLOG_INFO("this was destroyed");
-          }
-        });
-        return;
-      }
-      self->queue.front()(t, [alive](bool r) {
-        if (auto self = alive.lock())
+        if (upload->cancelled)
         {
-          self->timer.start([alive, r]() {
+          finish(RequestScheduler::Outcome::done, nullptr);
+          return;
+        }
+        self->token.get().get(
+          [upload, alive, finish = std::move(finish)](const std::string &t, const std::string &err) mutable {
             if (auto self = alive.lock())
             {
-              if (r)
-                self->queue.pop();
-              self->state = State::idle;
-              self->process();
+              if (upload->cancelled)
+              {
+                finish(RequestScheduler::Outcome::done, nullptr);
+                return;
+              }
+              if (t.empty())
+              {
+                self->lastError = err;
+                finish(RequestScheduler::Outcome::retry, nullptr);
+                return;
+              }
+              self->attempt(upload, t, std::move(finish));
             }
             else
-
             {
               SPDLOG_INFO("this was destroyed");
             }
           });
-        }
-        else
-        {
-          SPDLOG_INFO("this was destroyed");
-        }
-      });
-    }
-    else
+      }
+      else
+      {
+        SPDLOG_INFO("this was destroyed");
+      }
+    },
+    [upload]() {
+      if (!upload->cancelled)
+        upload->cb("");
+    });
+  return id;
+}
 
-    {
-      SPDLOG_INFO("this was destroyed");
-    }
-  });
+auto AzureStt::feed(UploadId id, const Wav &wav) -> void
+{
+  auto it = uploads.find(id);
+  if (it == std::end(uploads))
+    return;
+  auto &upload = *it->second;
+  const auto pos = upload.body.size();
+  appendPcm(upload.body, wav);
+  upload.samples += wav.size();
+  if (upload.stream != 0)
+    httpClient.get().append(upload.stream, std::string_view{upload.body}.substr(pos));
 }
 
-auto AzureStt::perform(Wav wav, int sampleRate, Callback cb) -> void
+auto AzureStt::end(UploadId id) -> void
 {
-  auto dur = 1.f * wav.size() / sampleRate;
+  auto it = uploads.find(id);
+  if (it == std::end(uploads))
+    return;
+  auto &upload = *it->second;
+  auto dur = 1.f * upload.samples / upload.sampleRate;
   total += dur;
   SPDLOG_INFO("Azure {} seconds, total: {} minutes {} seconds", dur, std::floor(total / 60.f), static_cast<int>(total) % 60);
-  queue.emplace([cb = std::move(cb), sampleRate, alive = weak_self(), wav = std::move(wav)](
-                  const std::string &t, PostTask postTask) mutable {
-    if (auto self = alive.lock())
-    {
-      std::ostringstream ss;
-      saveWav(ss, wav, sampleRate);
-      self->httpClient.get().post(
-        "https://eastus.stt.speech.microsoft.com/speech/recognition/conversation/cognitiveservices/"
-        "v1?language=en-US",
-        ss.str(),
-        [cb = std::move(cb), postTask = std::move(postTask), alive](
-          CURLcode code, long httpStatus, std::string payload) mutable {
-          if (auto self = alive.lock())
-          {
-            if (code != CURLE_OK)
-            {
-              cb("");
-              postTask(false);
-              return;
-            }
-            if (httpStatus == 401)
-            {
-              SPDLOG_INFO("{} {}", curl_easy_strerror(code), httpStatus);
-              self->token.get().clear();
-              cb("");
-              postTask(false);
-              return;
-            }
-            if (httpStatus >= 400 && httpStatus < 500)
-            {
-              SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
-              self->lastError = payload;
-              cb("");
-              postTask(true);
-              return;
-            }
-            if (httpStatus != 200)
-            {
-              SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
-              self->lastError = payload;
-              cb("");
-              self->timer.start([postTask = std::move(postTask)]() mutable { postTask(false); }, 10'000);
-              return;
-            }
+  upload.ended = true;
+  upload.endedAt = std::chrono::steady_clock::now();
+  if (upload.stream != 0)
+    httpClient.get().endUpload(upload.stream);
+  uploads.erase(it);
+}
 
-            self->lastError = "";
-            rapidjson::Document document;
-            document.Parse(payload.data(), payload.size());
-            // {"RecognitionStatus":"Success","Offset":600000,"Duration":30000000,"DisplayText":"What do you think about it?"}
-            auto const &display_text = document["DisplayText"];
-            cb(std::string_view{display_text.GetString(), display_text.GetStringLength()});
-            postTask(true);
-          }
-          else
-          {
-            SPDLOG_INFO("this was destroyed");
-          }
-        },
-        {{"Accept", ""},
-         {"User-Agent", "curl/7.68.0"},
-         {"Authorization", "Bearer " + t},
-         {"Content-Type", "audio/wav"}});
-    }
-    else
+auto AzureStt::cancel(UploadId id) -> void
+{
+  auto it = uploads.find(id);
+  if (it == std::end(uploads))
+    return;
+  auto upload = std::move(it->second);
+  uploads.erase(it);
+  upload->cancelled = true;
+  if (upload->stream != 0)
+    httpClient.get().cancel(upload->stream);
+}
 
-    {
-      SPDLOG_INFO("this was destroyed");
-    }
-  });
-  process();
+auto AzureStt::attempt(std::shared_ptr<Upload> upload, const std::string &t, Finish finish) -> void
+{
+  upload->stream = httpClient.get().postUpload(
+    "https://eastus.stt.speech.microsoft.com/speech/recognition/conversation/cognitiveservices/"
+    "v1?language=en-US",
+    upload->body,
+    [upload, finish = std::move(finish), alive = weak_self()](
+      CURLcode code, long httpStatus, std::string payload) mutable {
+      upload->stream = 0;
+      if (auto self = alive.lock())
+      {
+        if (upload->cancelled)
+        {
+          finish(RequestScheduler::Outcome::done, nullptr);
+          return;
+        }
+        if (code != CURLE_OK)
+        {
+          finish(RequestScheduler::Outcome::retry, nullptr);
+          return;
+        }
+        if (httpStatus == 401)
+        {
+          SPDLOG_INFO("{} {}", curl_easy_strerror(code), httpStatus);
+          self->token.get().clear();
+          finish(RequestScheduler::Outcome::retry, nullptr);
+          return;
+        }
+        if (httpStatus >= 400 && httpStatus < 500)
+        {
+          SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
+          self->lastError = payload;
+          finish(RequestScheduler::Outcome::done, [upload]() { upload->cb(""); });
+          return;
+        }
+        if (httpStatus != 200)
+        {
+          SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
+          self->lastError = payload;
+          finish(RequestScheduler::Outcome::retry, nullptr);
+          return;
+        }
+
+        self->lastError = "";
+        SPDLOG_INFO("Azure transcript {} ms after the end of speech",
+                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                          upload->endedAt)
+                      .count());
+        rapidjson::Document document;
+        document.Parse(payload.data(), payload.size());
+        // {"RecognitionStatus":"Success","Offset":600000,"Duration":30000000,"DisplayText":"What do you think about it?"}
+        auto text = std::string{};
+        if (document.IsObject() && document.HasMember("DisplayText"))
+        {
+          auto const &displayText = document["DisplayText"];
+          text.assign(displayText.GetString(), displayText.GetStringLength());
+        }
+        finish(RequestScheduler::Outcome::done, [upload, text = std::move(text)]() { upload->cb(text); });
+      }
+      else
+      {
+        SPDLOG_INFO("this was destroyed");
+      }
+    },
+    {{"Accept", ""},
+     {"User-Agent", "curl/7.68.0"},
+     {"Authorization", "Bearer " + t},
+     {"Content-Type", fmt::format("audio/wav; codecs=audio/pcm; samplerate={}", upload->sampleRate)},
+     {"Expect", ""}});
+  // the utterance can be over before its turn came or during a retry
+  if (upload->ended)
+    httpClient.get().endUpload(upload->stream);
 }
@@ -1,8 +1,12 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
 #include <functional>
-#include <queue>
+#include <memory>
 #include <string>
+#include <unordered_map>
 
+#include "request-scheduler.hpp"
 #include "shared_from_this.hpp"
 #include "uv.hpp"
 #include "wav.hpp"
@@ -11,25 +15,39 @@ class AzureStt : public virtual enable_shared_from_this
 {
 public:
   using Callback = std::move_only_function<void(std::string_view)>;
+  using UploadId = uint64_t;
   AzureStt(uv::Uv &, class AzureToken &, class HttpClient &);
   auto perform(Wav, int sampleRate, Callback) -> void;
+  // streams an utterance while it is still recorded, the callback gets the transcript after end()
+  auto begin(int sampleRate, Callback) -> UploadId;
+  auto feed(UploadId, const Wav &) -> void;
+  auto end(UploadId) -> void;
+  // drops the utterance, the callback is not called
+  auto cancel(UploadId) -> void;
 
   std::string lastError;
 
 private:
-  enum class State {
-    idle,
-    waiting
+  using Finish = RequestScheduler::Finish;
+
+  struct Upload
+  {
+    Callback cb;
+    int sampleRate;
+    std::string body; // kept whole for a retry
+    size_t samples = 0;
+    bool ended = false;
+    bool cancelled = false;
+    uint64_t stream = 0; // the attempt in flight, 0 if none
+    std::chrono::steady_clock::time_point endedAt;
   };
-  using PostTask = std::move_only_function<void(bool)>;
-  using Task = std::move_only_function<void(const std::string &t, PostTask)>;
 
-  uv::Timer timer;
   std::reference_wrapper<AzureToken> token;
   std::reference_wrapper<HttpClient> httpClient;
-  std::queue<Task> queue;
-  State state = State::idle;
+  RequestScheduler scheduler;
+  std::unordered_map<UploadId, std::shared_ptr<Upload>> uploads;
+  UploadId nextId = 1;
   float total = 0.f;
 
-  auto process() -> void;
+  auto attempt(std::shared_ptr<Upload>, const std::string &token, Finish) -> void;
 };
@@ -4,47 +4,64 @@
 
 #include "http-client.hpp"
 
-AzureToken::AzureToken(std::string aKey, class HttpClient &aHttpClient)
-  : key(std::move(aKey)), httpClient(aHttpClient)
+using namespace std::chrono_literals;
+
+// Azure issues tokens valid for 10 minutes
+static constexpr auto TokenLifetime = std::chrono::milliseconds{9min};
+static constexpr auto RefreshAfter = std::chrono::milliseconds{8min};
+static constexpr auto RefreshRetry = std::chrono::milliseconds{10s};
+
+AzureToken::AzureToken(uv::Uv &uv, std::string aKey, class HttpClient &aHttpClient)
+  : refreshTimer(uv.createTimer()), key(std::move(aKey)), httpClient(aHttpClient)
 {
 }
 
 auto AzureToken::get(Callback cb) -> void
 {
-  callbacks.emplace_back(std::move(cb));
-  if (!token.empty())
+  if (!token.empty() && Clock::now() < expiresAt)
   {
-    for (auto &lCb : callbacks)
-      lCb(token, "");
-    callbacks.clear();
+    // a refresh in flight does not hold this up, the current token is still good
+    isUsed = true;
+    cb(token, "");
     return;
   }
+  token.clear();
+  callbacks.emplace_back(std::move(cb));
+  // concurrent requests share one token fetch
+  if (!isFetching)
+    fetch();
+}
+
+auto AzureToken::fetch() -> void
+{
+  isFetching = true;
   httpClient.get().post(
     "https://eastus.api.cognitive.microsoft.com/sts/v1.0/issuetoken",
     "",
-    [alive = weak_self()](CURLcode code, long httpStatus, std::string payload) {
+    [alive = weak_self(), key = key](CURLcode code, long httpStatus, std::string payload) {
       if (auto self = alive.lock())
       {
+        self->isFetching = false;
+        if (key != self->key)
+        {
+          // the key changed while this was in flight, get the token for the new one
+          if (!self->callbacks.empty())
+            self->fetch();
+          return;
+        }
         if (code != CURLE_OK)
         {
           SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
-          for (auto &lCb : self->callbacks)
-            lCb("", std::string{"CURL Error: "} + curl_easy_strerror(code));
-          self->callbacks.clear();
+          self->onFetched("", std::string{"CURL Error: "} + curl_easy_strerror(code));
           return;
         }
         if (httpStatus != 200)
         {
           SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
-          for (auto &lCb : self->callbacks)
-            lCb("", "HTTP Status: " + std::to_string(httpStatus) + " " + payload);
-          self->callbacks.clear();
+          self->onFetched("", "HTTP Status: " + std::to_string(httpStatus) + " " + payload);
           return;
         }
-        self->token = std::move(payload);
-        for (auto &lCb : self->callbacks)
-          lCb(self->token, "");
-        self->callbacks.clear();
+        self->onFetched(std::move(payload), "");
       }
       else
 
@@ -55,6 +72,53 @@ auto AzureToken::get(Callback cb) -> void
     {{"Ocp-Apim-Subscription-Key", key}, {"Expect", ""}});
 }
 
+auto AzureToken::onFetched(std::string aToken, const std::string &err) -> void
+{
+  if (aToken.empty())
+  {
+    // a failed refresh keeps the current token until it expires
+    if (!token.empty())
+    {
+      isUsed = true;
+      scheduleRefresh(RefreshRetry);
+    }
+    for (auto &lCb : std::exchange(callbacks, {}))
+      lCb("", err);
+    return;
+  }
+  token = std::move(aToken);
+  expiresAt = Clock::now() + TokenLifetime;
+  isUsed = !callbacks.empty();
+  scheduleRefresh(RefreshAfter);
+  for (auto &lCb : std::exchange(callbacks, {}))
+    lCb(token, "");
+}
+
+auto AzureToken::scheduleRefresh(std::chrono::milliseconds delay) -> void
+{
+  refreshTimer.start(
+    [alive = weak_self()]() {
+      if (auto self = alive.lock())
+      {
+        if (self->token.empty() || self->isFetching)
+          return;
+        // an idle token is let go, the next request fetches a new one
+        if (!self->isUsed)
+        {
+          self->token.clear();
+          return;
+        }
+        self->isUsed = false;
+        self->fetch();
+      }
+      else
+      {
+        SPDLOG_INFO("this was destroyed");
+      }
+    },
+    static_cast<uint64_t>(delay.count()));
+}
+
 auto AzureToken::clear() -> void
 {
   token.clear();
@@ -66,4 +130,5 @@ auto AzureToken::updateKey(const std::string &k) -> void
     return;
   key = k;
   token.clear();
+  refreshTimer.stop();
 }
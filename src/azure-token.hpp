@@ -1,22 +1,34 @@
 #pragma once
+#include <chrono>
 #include <functional>
 #include <string>
 #include <vector>
 
 #include "shared_from_this.hpp"
+#include "uv.hpp"
 
 class AzureToken : public virtual enable_shared_from_this
 {
 public:
   using Callback = std::move_only_function<auto(const std::string &token, const std::string &err)->void>;
-  AzureToken(std::string key, class HttpClient &);
+  AzureToken(uv::Uv &, std::string key, class HttpClient &);
   auto clear() -> void;
   auto get(Callback) -> void;
   auto updateKey(const std::string &) -> void;
 
 private:
+  using Clock = std::chrono::steady_clock;
+
+  uv::Timer refreshTimer;
   std::string key;
   std::reference_wrapper<HttpClient> httpClient;
   std::vector<Callback> callbacks;
   std::string token;
+  Clock::time_point expiresAt;
+  bool isFetching = false;
+  bool isUsed = false;
+
+  auto fetch() -> void;
+  auto onFetched(std::string token, const std::string &err) -> void;
+  auto scheduleRefresh(std::chrono::milliseconds) -> void;
 };
@@ -2,16 +2,25 @@
 #include "audio-sink.hpp"
 #include "azure-token.hpp"
 #include "http-client.hpp"
+#include "jobs.hpp"
 #include <rapidjson/document.h>
 #include <spdlog/spdlog.h>
 
+// requests overlap so the synthesis of the next sentence is ready when the current one ends
+static constexpr auto MaxInFlight = 3U;
+static constexpr auto MaxPerSec = 5.f;
+
 AzureTts::AzureTts(uv::Uv &uv,
+                   Jobs &aJobs,
                    AzureToken &azureToken,
                    class HttpClient &aHttpClient,
                    class AudioSink &aAudioSink)
-  : timer(uv.createTimer()), token(azureToken), httpClient(aHttpClient), audioSink(aAudioSink)
+  : jobs(aJobs),
+    token(azureToken),
+    httpClient(aHttpClient),
+    audioSink(aAudioSink),
+    scheduler(uv, MaxInFlight, MaxPerSec)
 {
-  process();
 }
 
 static std::string escape(std::string data)
@@ -33,249 +42,219 @@ static std::string escape(std::string data)
   return buffer;
 }
 
-auto AzureTts::say(std::string voice, std::string msg, bool overlap) -> void
+auto AzureTts::authorized(Finish finish, Authorized then) -> void
 {
-  queue.emplace([msg = std::move(msg),
-                 alive = weak_self(),
-                 voice = std::move(voice),
-                 overlap](std::string_view t, PostTask postTask) {
+  token.get().get([alive = weak_self(), finish = std::move(finish), then = std::move(then)](
+                    const std::string &t, const std::string &err) mutable {
     if (auto self = alive.lock())
     {
-      auto xml = R"(<speak version="1.0" xml:lang="en-us"><voice xml:lang="en-US" name=")" + voice +
-                 R"("><prosody rate="0.00%">)" + escape(msg) + R"(</prosody></voice></speak>)";
-      self->httpClient.get().post(
-        "https://eastus.tts.speech.microsoft.com/cognitiveservices/v1",
-        std::move(xml),
-        [overlap, postTask = std::move(postTask), alive](
-          CURLcode code, long httpStatus, std::string payload) mutable {
-          if (auto self = alive.lock())
-          {
-            if (code != CURLE_OK)
-            {
-              postTask(false);
-              return;
-            }
-            if (httpStatus == 401)
-            {
-              SPDLOG_INFO("{} {}", curl_easy_strerror(code), httpStatus);
-              self->token.get().clear();
-              postTask(false);
-              return;
-            }
-            if (httpStatus >= 400 && httpStatus < 500)
-            {
-              SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
-              self->lastError = payload;
-              postTask(true);
-              return;
-            }
-            if (httpStatus != 200)
-            {
-              SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
-              self->lastError = payload;
-              self->timer.start([postTask = std::move(postTask)]() mutable { postTask(false); }, 10'000);
-              return;
-            }
-
-            self->lastError = "";
-            Wav wav;
-            const auto inF = 24000;
-            const auto outF = self->audioSink.get().sampleRate();
-            const auto inSz = static_cast<int>(payload.size() / sizeof(int16_t));
-            const auto outSz = static_cast<int>(static_cast<int64_t>(inSz) * outF / inF);
-            wav.resize(outSz);
-            for (auto i = 0; i < outSz; ++i)
-              wav[i] = reinterpret_cast<int16_t *>(payload.data())[static_cast<int64_t>(i) * inF / outF];
-            self->audioSink.get().ingest(std::move(wav), overlap);
-            postTask(true);
-          }
-          else
-
-          {
-            SPDLOG_INFO("this was destroyed");
-          }
-        },
-        {{"Accept", ""},
-         {"User-Agent", "curl/7.68.0"},
-         {"Authorization", fmt::format("Bearer {}", t)},
-         {"Content-Type", "application/ssml+xml"},
-         {"X-Microsoft-OutputFormat", "raw-24khz-16bit-mono-pcm"}});
+      if (t.empty())
+      {
+        self->lastError = err;
+        finish(RequestScheduler::Outcome::retry, nullptr);
+        return;
+      }
+      then(t, std::move(finish));
     }
     else
-
     {
       SPDLOG_INFO("this was destroyed");
     }
   });
-  process();
 }
 
-auto AzureTts::process() -> void
+auto AzureTts::say(std::string voice, std::string msg, bool overlap) -> void
 {
-  if (state == State::waiting)
-    return;
-  if (queue.empty())
-  {
-    state = State::idle;
-    return;
-  }
-  state = State::waiting;
-  token.get().get([alive = weak_self()](const std::string &t, const std::string &err) {
+  auto xml = R"(<speak version="1.0" xml:lang="en-us"><voice xml:lang="en-US" name=")" + voice +
+             R"("><prosody rate="0.00%">)" + escape(msg) + R"(</prosody></voice></speak>)";
+  scheduler.push([alive = weak_self(), xml = std::move(xml), overlap](Finish finish) {
     if (auto self = alive.lock())
-    {
-
-      if (t.empty())
-      {
-        self->lastError = err;
-        self->timer.start([alive]() {
-          if (auto self = alive.lock())
-          {
-            self->state = State::idle;
-            self->process();
-          }
-          else
-          {
-            SPDLOG_INFO("this was destroyed");
-          }
-        });
-        return;
-      }
-      self->queue.front()(t, [alive](bool r) {
+      self->authorized(std::move(finish), [alive, xml, overlap](const std::string &t, Finish finish) {
         if (auto self = alive.lock())
-        {
-          self->timer.start([alive, r]() {
-            if (auto self = alive.lock())
-            {
-              if (r)
-                self->queue.pop();
-              self->state = State::idle;
-              self->process();
-            }
-            else
-            {
-              SPDLOG_INFO("this was destroyed");
-            }
-          });
-        }
+          self->httpClient.get().post(
+            "https://eastus.tts.speech.microsoft.com/cognitiveservices/v1",
+            xml,
+            [overlap, finish = std::move(finish), alive](
+              CURLcode code, long httpStatus, std::string payload) mutable {
+              if (auto self = alive.lock())
+              {
+                if (code != CURLE_OK)
+                {
+                  finish(RequestScheduler::Outcome::retry, nullptr);
+                  return;
+                }
+                if (httpStatus == 401)
+                {
+                  SPDLOG_INFO("{} {}", curl_easy_strerror(code), httpStatus);
+                  self->token.get().clear();
+                  finish(RequestScheduler::Outcome::retry, nullptr);
+                  return;
+                }
+                if (httpStatus >= 400 && httpStatus < 500)
+                {
+                  SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
+                  self->lastError = payload;
+                  finish(RequestScheduler::Outcome::done, nullptr);
+                  return;
+                }
+                if (httpStatus != 200)
+                {
+                  SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
+                  self->lastError = payload;
+                  finish(RequestScheduler::Outcome::retry, nullptr);
+                  return;
+                }
+
+                self->lastError = "";
+                Wav wav;
+                const auto inF = 24000;
+                const auto outF = self->audioSink.get().sampleRate();
+                const auto inSz = static_cast<int>(payload.size() / sizeof(int16_t));
+                const auto outSz = static_cast<int>(static_cast<int64_t>(inSz) * outF / inF);
+                wav.resize(outSz);
+                for (auto i = 0; i < outSz; ++i)
+                  wav[i] = reinterpret_cast<int16_t *>(payload.data())[static_cast<int64_t>(i) * inF / outF];
+                // played in the order the messages were said, not in the order they were synthesized
+                finish(RequestScheduler::Outcome::done, [alive, wav = std::move(wav), overlap]() mutable {
+                  if (auto self = alive.lock())
+                    self->audioSink.get().ingest(std::move(wav), overlap);
+                  else
+                    SPDLOG_INFO("this was destroyed");
+                });
+              }
+              else
+              {
+                SPDLOG_INFO("this was destroyed");
+              }
+            },
+            {{"Accept", ""},
+             {"User-Agent", "curl/7.68.0"},
+             {"Authorization", fmt::format("Bearer {}", t)},
+             {"Content-Type", "application/ssml+xml"},
+             {"X-Microsoft-OutputFormat", "raw-24khz-16bit-mono-pcm"}});
         else
-        {
           SPDLOG_INFO("this was destroyed");
-          return;
-        }
       });
-    }
     else
-    {
       SPDLOG_INFO("this was destroyed");
-    }
   });
 }
 
-auto AzureTts::listVoices(ListVoicesCallback cb) -> void
+auto AzureTts::listVoices(ListVoicesCallback aCb) -> void
 {
-  queue.emplace([cb = std::move(cb), alive = weak_self()](std::string_view t, PostTask postTask) mutable {
-    if (auto self = alive.lock())
-    {
-      self->httpClient.get().get(
-        "https://eastus.tts.speech.microsoft.com/cognitiveservices/voices/list",
-        [cb = std::move(cb), postTask = std::move(postTask), alive](
-          CURLcode code, long httpStatus, std::string payload) mutable {
+  auto cb = std::make_shared<ListVoicesCallback>(std::move(aCb));
+  scheduler.push(
+    [cb, alive = weak_self()](Finish finish) {
+      if (auto self = alive.lock())
+        self->authorized(std::move(finish), [cb, alive](const std::string &t, Finish finish) {
           if (auto self = alive.lock())
-          {
-            if (code != CURLE_OK)
-            {
-              cb({});
-              postTask(false);
-              return;
-            }
-            if (httpStatus == 401)
-            {
-              SPDLOG_INFO("{} {}", curl_easy_strerror(code), httpStatus);
-              self->token.get().clear();
-              cb({});
-              postTask(false);
-              return;
-            }
-            if (httpStatus != 200)
-            {
-              SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
-              self->lastError = payload;
-              cb({});
-              postTask(false);
-              return;
-            }
-
-            rapidjson::Document document;
-            document.Parse(payload.data(), payload.size());
-            std::vector<std::string_view> voices;
-            for (auto const &element : document.GetArray())
-            {
-              //[
-              //  {
-              //    "Name": "Microsoft Server Speech Text to Speech Voice (af-ZA, AdriNeural)",
-              //    "DisplayName": "Adri",
-              //    "LocalName": "Adri",
-              //    "ShortName": "af-ZA-AdriNeural",
-              //    "Gender": "Female",
-              //    "Locale": "af-ZA",
-              //    "LocaleName": "Afrikaans (South Africa)",
-              //    "SampleRateHertz": "48000",
-              //    "VoiceType": "Neural",
-              //    "Status": "GA",
-              //    "WordsPerMinute": "147"
-              //  },
-              //  {
-              //    "Name": "Microsoft Server Speech Text to Speech Voice (af-ZA, WillemNeural)",
-              //    "DisplayName": "Willem",
-              //    "LocalName": "Willem",
-              //    "ShortName": "af-ZA-WillemNeural",
-              //    "Gender": "Male",
-              //    "Locale": "af-ZA",
-              //    "LocaleName": "Afrikaans (South Africa)",
-              //    "SampleRateHertz": "48000",
-              //    "VoiceType": "Neural",
-              //    "Status": "GA",
-              //    "WordsPerMinute": "155"
-              //  },
-              //  {
-              //    "Name": "Microsoft Server Speech Text to Speech Voice (am-ET, AmehaNeural)",
-              //    "DisplayName": "Ameha",
-              //    "LocalName": "አምሀ",
-              //    "ShortName": "am-ET-AmehaNeural",
-              //    "Gender": "Male",
-              //    "Locale": "am-ET",
-              //    "LocaleName": "Amharic (Ethiopia)",
-              //    "SampleRateHertz": "48000",
-              //    "VoiceType": "Neural",
-              //    "Status": "GA",
-              //    "WordsPerMinute": "112"
-              //  }, ...
+            self->httpClient.get().get(
+              "https://eastus.tts.speech.microsoft.com/cognitiveservices/voices/list",
+              [cb, finish = std::move(finish), alive](CURLcode code, long httpStatus, std::string payload) mutable {
+                if (auto self = alive.lock())
+                {
+                  if (httpStatus == 401)
+                  {
+                    SPDLOG_INFO("{} {}", curl_easy_strerror(code), httpStatus);
+                    self->token.get().clear();
+                    finish(RequestScheduler::Outcome::retry, nullptr);
+                    return;
+                  }
+                  if (code != CURLE_OK || httpStatus != 200)
+                  {
+                    SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
+                    self->lastError = payload;
+                    finish(RequestScheduler::Outcome::done, [cb]() { (*cb)({}); });
+                    return;
+                  }
 
-              const auto locale = std::string_view{element["Locale"].GetString(), element["Locale"].GetStringLength()};
-              if (locale.starts_with("en-") != 0)
-                continue;
-              voices.emplace_back(std::string_view{element["ShortName"].GetString(), element["ShortName"].GetStringLength()});
-            }
-            self->lastError.clear();
-
-            cb(voices);
-            postTask(true);
-          }
+                  // the list is a few hundred kilobytes of JSON, parse it off the loop thread
+                  auto voices = std::make_shared<std::vector<std::string>>();
+                  self->jobs.get().submit(
+                    [voices, payload = std::move(payload)]() {
+                      rapidjson::Document document;
+                      document.Parse(payload.data(), payload.size());
+                      if (!document.IsArray())
+                        return;
+                      for (auto const &element : document.GetArray())
+                      {
+                        //[
+                        //  {
+                        //    "Name": "Microsoft Server Speech Text to Speech Voice (af-ZA, AdriNeural)",
+                        //    "DisplayName": "Adri",
+                        //    "LocalName": "Adri",
+                        //    "ShortName": "af-ZA-AdriNeural",
+                        //    "Gender": "Female",
+                        //    "Locale": "af-ZA",
+                        //    "LocaleName": "Afrikaans (South Africa)",
+                        //    "SampleRateHertz": "48000",
+                        //    "VoiceType": "Neural",
+                        //    "Status": "GA",
+                        //    "WordsPerMinute": "147"
+                        //  },
+                        //  {
+                        //    "Name": "Microsoft Server Speech Text to Speech Voice (af-ZA, WillemNeural)",
+                        //    "DisplayName": "Willem",
+                        //    "LocalName": "Willem",
+                        //    "ShortName": "af-ZA-WillemNeural",
+                        //    "Gender": "Male",
+                        //    "Locale": "af-ZA",
+                        //    "LocaleName": "Afrikaans (South Africa)",
+                        //    "SampleRateHertz": "48000",
+                        //    "VoiceType": "Neural",
+                        //    "Status": "GA",
+                        //    "WordsPerMinute": "155"
+                        //  },
+                        //  {
+                        //    "Name": "Microsoft Server Speech Text to Speech Voice (am-ET, AmehaNeural)",
+                        //    "DisplayName": "Ameha",
+                        //    "LocalName": "አምሀ",
+                        //    "ShortName": "am-ET-AmehaNeural",
+                        //    "Gender": "Male",
+                        //    "Locale": "am-ET",
+                        //    "LocaleName": "Amharic (Ethiopia)",
+                        //    "SampleRateHertz": "48000",
+                        //    "VoiceType": "Neural",
+                        //    "Status": "GA",
+                        //    "WordsPerMinute": "112"
+                        //  }, ...
+                        const auto locale =
+                          std::string_view{element["Locale"].GetString(), element["Locale"].GetStringLength()};
+                        if (locale.starts_with("en-") != 0)
+                          continue;
+                        voices->emplace_back(element["ShortName"].GetString(), element["ShortName"].GetStringLength());
+                      }
+                    },
+                    [cb, finish = std::move(finish), alive, voices]() mutable {
+                      if (auto self = alive.lock())
+                      {
+                        self->lastError.clear();
+                        finish(RequestScheduler::Outcome::done, [cb, voices]() {
+                          auto views = std::vector<std::string_view>{std::begin(*voices), std::end(*voices)};
+                          (*cb)(views);
+                        });
+                      }
+                      else
+                      {
+                        SPDLOG_INFO("this was destroyed");
+                      }
+                    });
+                }
+                else
+                {
+                  SPDLOG_INFO("this was destroyed");
+                }
+              },
+              {
+                {"Accept", ""},
+                {"User-Agent", "curl/7.68.0"},
+                {"Authorization", fmt::format("Bearer {}", t)},
+              });
           else
-          {
             SPDLOG_INFO("this was destroyed");
-          }
-        },
-        {
-          {"Accept", ""},
-          {"User-Agent", "curl/7.68.0"},
-          {"Authorization", fmt::format("Bearer {}", t)},
         });
-    }
-    else
-    {
-      SPDLOG_INFO("this was destroyed");
-    }
-  });
-  process();
+      else
+        SPDLOG_INFO("this was destroyed");
+    },
+    [cb]() { (*cb)({}); });
 }
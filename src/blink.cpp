@@ -35,13 +35,26 @@ auto Blink<S, ClassName>::load(IStrm &strm) -> void
   Node::load(strm);
 }
 
+template <typename S, typename ClassName>
+auto Blink<S, ClassName>::preload() const -> void
+{
+  sprite.preload(openEyes);
+  sprite.preload(closedEyes);
+}
+
 template <typename S, typename ClassName>
 auto Blink<S, ClassName>::render(float dt, Node *hovered, Node *selected) -> void
 {
-  if (sprite.numFrames() > 0)
-    sprite.frame((state == State::open ? openEyes : closedEyes) % sprite.numFrames());
-  sprite.render();
+  // the other state is never more than a blink away
+  sprite.prefetch(state == State::open ? closedEyes : openEyes);
+  if (isOnScreen())
+    sprite.render();
   Node::render(dt, hovered, selected);
+}
+
+template <typename S, typename ClassName>
+auto Blink<S, ClassName>::tick(float /*dt*/) -> void
+{
   const auto now = std::chrono::high_resolution_clock::now();
   if (now > nextEventTime)
   {
@@ -53,6 +66,8 @@ auto Blink<S, ClassName>::render(float dt, Node *hovered, Node *selected) -> voi
                        ? std::chrono::microseconds(static_cast<int64_t>(blinkEvery * 1'000'000))
                        : std::chrono::microseconds(static_cast<int64_t>(blinkDuration * 1'000'000));
   }
+  if (sprite.numFrames() > 0)
+    sprite.frame((state == State::open ? openEyes : closedEyes) % sprite.numFrames());
 }
 
 template <typename S, typename ClassName>
@@ -40,7 +40,13 @@ private:
   auto h() const -> float final;
   auto isTransparent(glm::vec2) const -> bool final;
   auto load(IStrm &) -> void final;
+  auto preload() const -> void final;
   auto render(float dt, Node *hovered, Node *selected) -> void final;
+  auto tick(float dt) -> void final;
+  auto textureRefs(std::vector<const std::shared_ptr<const Texture> *> &v) const -> void final
+  {
+    sprite.textureRefs(v);
+  }
   auto renderUi() -> void final;
   auto save(OStrm &) const -> void final;
   auto w() const -> float final;
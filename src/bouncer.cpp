@@ -17,13 +17,17 @@ auto Bouncer::do_clone() const -> std::shared_ptr<Node>
 
 auto Bouncer::render(float dt, Node *hovered, Node *selected) -> void
 {
-  zOrder = INT_MIN;
+  zOrder() = INT_MIN;
   glClearColor(clearColor.x, clearColor.y, clearColor.z, clearColor.w);
   glClear(GL_COLOR_BUFFER_BIT);
-  dLoc.y += std::min(1000.f * dt / 250.f, 1.f) * (strength * audioLevel.getLevel() - dLoc.y);
   Node::render(dt, hovered, selected);
 }
 
+auto Bouncer::tick(float dt) -> void
+{
+  dLoc().y += std::min(1000.f * dt / 250.f, 1.f) * (strength * audioLevel.getLevel() - dLoc().y);
+}
+
 auto Bouncer::renderUi() -> void
 {
   Node::renderUi();
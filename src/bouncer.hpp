@@ -21,6 +21,7 @@ private:
   ImVec4 clearColor = ImVec4(123.f / 256.f, 164.f / 256.f, 119.f / 256.f, 1.00f);
   AudioLevel audioLevel;
   auto render(float dt, Node *hovered, Node *selected) -> void final;
+  auto tick(float dt) -> void final;
   auto renderUi() -> void final;
   auto save(OStrm &) const -> void final;
   auto load(IStrm &) -> void final;
@@ -17,10 +17,14 @@ auto Bouncer2::do_clone() const -> std::shared_ptr<Node>
 
 auto Bouncer2::render(float dt, Node *hovered, Node *selected) -> void
 {
-  dLoc.y += std::min(1000.f * dt / easing, 1.f) * (strength * audioLevel.getLevel() - dLoc.y);
   Node::render(dt, hovered, selected);
 }
 
+auto Bouncer2::tick(float dt) -> void
+{
+  dLoc().y += std::min(1000.f * dt / easing, 1.f) * (strength * audioLevel.getLevel() - dLoc().y);
+}
+
 auto Bouncer2::renderUi() -> void
 {
   Node::renderUi();
@@ -20,6 +20,7 @@ private:
   AudioLevel audioLevel;
 
   auto render(float dt, Node *hovered, Node *selected) -> void final;
+  auto tick(float dt) -> void final;
   auto renderUi() -> void final;
   auto save(OStrm &) const -> void final;
   auto load(IStrm &) -> void final;
@@ -3,6 +3,7 @@
 #include "imgui-helpers.hpp"
 #include "lib.hpp"
 #include "no-voice.hpp"
+#include "preferences.hpp"
 #include "ui.hpp"
 #include "undo.hpp"
 #include <scn/scn.h>
@@ -19,6 +20,7 @@ Chat::Chat(class Lib &aLib, Undo &aUndo, uv::Uv &aUv, AudioSink &aAudioSink, std
     font(aLib.queryFont(sdl::get_base_path() / "assets/notepad_font/NotepadFont.ttf", ptsize)),
     timer(std::make_shared<uv::Timer>(aUv.createTimer()))
 {
+  trimHistory();
   twitch->reg(*this);
 }
 
@@ -99,6 +101,13 @@ static auto getDialogLine(const std::string &text, bool isMe)
   return "said:";
 }
 
+// the wrapped lines roughly duplicate the text
+template <typename Entry>
+static auto entryBytes(const Entry &v) -> size_t
+{
+  return sizeof(Entry) + 2 * (v.msg.displayName.size() + v.msg.msg.size());
+}
+
 auto Chat::onMsg(Msg val) -> void
 {
   showChat = true;
@@ -132,7 +141,37 @@ auto Chat::onMsg(Msg val) -> void
       audioSink.get().ingest(noVoice());
     lastName = displayName;
   }
-  msgs.emplace_back(std::move(val));
+  // picks up a changed history size before the ring is checked for room
+  trimHistory();
+  if (!msgs.empty() && msgs.size() == msgs.capacity())
+  {
+    msgsBytes -= entryBytes(msgs.front());
+    msgs.pop_front();
+  }
+  msgs.push_back(Entry{std::move(val), {}});
+  msgsBytes += entryBytes(msgs.back());
+  layout(msgs.back());
+  // after the push, so the history is within the budget between messages
+  trimHistory();
+}
+
+auto Chat::trimHistory() -> void
+{
+  const auto &preferences = lib.get().preferences();
+  const auto capacity = static_cast<size_t>(std::max(1, preferences.chatHistorySize));
+  if (capacity != msgs.capacity())
+  {
+    msgs.setCapacity(capacity);
+    msgsBytes = 0;
+    for (auto i = 0U; i < msgs.size(); ++i)
+      msgsBytes += entryBytes(msgs[i]);
+  }
+  const auto maxBytes = static_cast<size_t>(std::max(1, preferences.chatHistoryKb)) * 1024;
+  while (!msgs.empty() && msgsBytes > maxBytes)
+  {
+    msgsBytes -= entryBytes(msgs.front());
+    msgs.pop_front();
+  }
 }
 
 static auto toLower(std::string v) -> std::string
@@ -201,25 +240,24 @@ auto Chat::render(float dt, Node *hovered, Node *selected) -> void
     return;
   }
   auto y = 0.f;
-  for (auto it = msgs.rbegin(); it != msgs.rend(); ++it)
+  for (auto i = msgs.size(); i-- > 0;)
   {
-    const auto displayNameDim = font->getSize(it->displayName);
-    auto const msg = fmt::format(": {}", it->msg);
+    const auto &msg = msgs[i].msg;
+    const auto &l = layout(msgs[i]);
 
     glColor3f(1.f, 1.f, 1.f);
-    const auto wrappedLines = wrapText(msg, displayNameDim.x);
-    for (auto ln = wrappedLines.rbegin(); ln != wrappedLines.rend(); ++ln)
+    for (auto ln = l.lines.rbegin(); ln != l.lines.rend(); ++ln)
     {
       if (y > h())
         break;
-      const auto isLast = ln == (wrappedLines.rend() - 1);
-      font->render(glm::vec2{isLast ? displayNameDim.x : 0, y}, *ln);
+      const auto isLast = ln == (l.lines.rend() - 1);
+      font->render(glm::vec2{isLast ? l.nameSize.x : 0, y}, *ln);
       if (isLast)
       {
-        glColor3f(it->color.x, it->color.y, it->color.z);
-        font->render(glm::vec2{0.f, y}, it->displayName);
+        glColor3f(msg.color.x, msg.color.y, msg.color.z);
+        font->render(glm::vec2{0.f, y}, msg.displayName);
       }
-      y += displayNameDim.y;
+      y += l.nameSize.y;
     }
 
     if (y > h())
@@ -229,27 +267,42 @@ auto Chat::render(float dt, Node *hovered, Node *selected) -> void
   Node::render(dt, hovered, selected);
 }
 
+auto Chat::layout(Entry &v) const -> const Layout &
+{
+  auto &l = v.layout;
+  if (l.width == w() && l.ptsize == ptsize)
+    return l;
+  l.width = w();
+  l.ptsize = ptsize;
+  l.nameSize = font->getSize(v.msg.displayName);
+  l.lines = wrapText(fmt::format(": {}", v.msg.msg), l.nameSize.x);
+  return l;
+}
+
 auto Chat::wrapText(std::string_view text, float initial_offset) const -> std::vector<std::string>
 {
   std::vector<std::string> lines;
   std::string line;
+  const auto spaceWidth = font->getSize(" ").x;
+  auto lineWidth = 0.f;
   while (auto result = scn::scan_value<std::string_view>(text))
   {
     text = result.range_as_string_view();
     auto const word = result.value();
-
-    if (line.empty())
-      line += word;
-    else
-      (line += " ") += word;
-    const auto text_dimensions = font->getSize(line);
-    if (text_dimensions.x > w() - initial_offset)
+    const auto wordWidth = font->getSize(word).x;
+    const auto newWidth = line.empty() ? wordWidth : lineWidth + spaceWidth + wordWidth;
+    if (newWidth > w() - initial_offset)
     {
       initial_offset = 0;
-      line.resize(line.size() == word.size() ? 0 : line.size() - word.size() - 1);
       lines.emplace_back(std::move(line));
       line = word;
+      lineWidth = wordWidth;
+      continue;
     }
+    if (!line.empty())
+      line += " ";
+    line += word;
+    lineWidth = newWidth;
   }
   if (!line.empty())
     lines.emplace_back(std::move(line));
@@ -446,8 +499,13 @@ auto Chat::renderUi() -> void
   ImGui::TableNextColumn();
   if (auto chatListBox =
         Ui::ListBox{"##Chat", ImVec2(-FLT_MIN, 5 * ImGui::GetTextLineHeightWithSpacing())})
-    for (const auto &msg : msgs)
-      ImGui::TextF("{}: {}", msg.displayName, msg.msg);
+  {
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(msgs.size()));
+    while (clipper.Step())
+      for (auto i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+        ImGui::TextF("{}: {}", msgs[i].msg.displayName, msgs[i].msg.msg);
+  }
   if (!twitch->isConnected())
     ImGui::PopStyleColor();
 }
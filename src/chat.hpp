@@ -2,6 +2,7 @@
 
 #include "lib.hpp"
 #include "node.hpp"
+#include "ring.hpp"
 #include "twitch-sink.hpp"
 #include "twitch.hpp"
 #include "uv.hpp"
@@ -29,8 +30,23 @@ private:
   std::reference_wrapper<Lib> lib;
   std::reference_wrapper<AudioSink> audioSink;
   std::shared_ptr<Twitch> twitch;
+  // wrapped lines of a message, valid for the width and font size it was laid out with
+  struct Layout
+  {
+    float width = -1.f;
+    int ptsize = 0;
+    glm::vec2 nameSize = {0.f, 0.f};
+    std::vector<std::string> lines;
+  };
+  struct Entry
+  {
+    Msg msg;
+    Layout layout;
+  };
+
   std::shared_ptr<Font> font;
-  std::vector<Msg> msgs;
+  Ring<Entry> msgs;
+  size_t msgsBytes = 0;
   std::shared_ptr<uv::Timer> timer;
   bool showChat = false;
   bool tts = false;
@@ -48,10 +64,13 @@ protected:
 
 private:
   auto h() const -> float final;
+  auto actsWhileHidden() const -> bool final { return true; }
   auto onMsg(Msg) -> void final;
   auto render(float dt, Node *hovered, Node *selected) -> void final;
   auto renderUi() -> void final;
   auto w() const -> float final;
+  auto layout(Entry &) const -> const Layout &;
+  auto trimHistory() -> void;
   auto wrapText(std::string_view text, float initOffset) const -> std::vector<std::string>;
   auto getVoice(const std::string &name) const -> std::string;
   auto do_clone() const -> std::shared_ptr<Node>;
@@ -28,9 +28,9 @@ auto EyeV2::do_clone() const -> std::shared_ptr<Node>
   return std::make_shared<EyeV2>(*this);
 }
 
-auto EyeV2::render(float dt, Node *hovered, Node *selected) -> void
+auto EyeV2::tick(float dt) -> void
 {
-  auto clampMouse = [&]() {
+  clampedMouse = [&]() {
     const auto mousePivot = (mouse - pivot()) * followStrength / 100.f;
     const auto distance = glm::length(mousePivot);
 
@@ -41,8 +41,12 @@ auto EyeV2::render(float dt, Node *hovered, Node *selected) -> void
     }
     return mousePivot;
   }();
+  AnimSprite::tick(dt);
+}
 
-  glTranslatef(clampMouse.x, clampMouse.y, .0f);
+auto EyeV2::render(float dt, Node *hovered, Node *selected) -> void
+{
+  glTranslatef(clampedMouse.x, clampedMouse.y, .0f);
   AnimSprite::render(dt, hovered, selected);
   if (selected == this)
   {
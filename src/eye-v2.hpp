@@ -22,6 +22,7 @@ private:
   float radius = 20.f;
   float followStrength = 4.f;
   glm::vec2 mouse;
+  glm::vec2 clampedMouse = {0.f, 0.f};
   std::reference_wrapper<MouseTracking> mouseTracking;
   glm::ivec2 screenTopLeft;
   glm::ivec2 screenBottomRight;
@@ -29,6 +30,7 @@ private:
 
   auto load(IStrm &) -> void final;
   auto render(float dt, Node *hovered, Node *selected) -> void final;
+  auto tick(float dt) -> void final;
   auto renderUi() -> void final;
   auto save(OStrm &) const -> void final;
   auto ingest(const glm::mat4 &projMat, glm::vec2 v) -> void final;
@@ -19,7 +19,7 @@ auto Eye::do_clone() const -> std::shared_ptr<Node>
   return std::make_shared<Eye>(*this);
 }
 
-auto Eye::render(float dt, Node *hovered, Node *selected) -> void
+auto Eye::tick(float dt) -> void
 {
   auto clampMouse = [&]() {
     const auto mousePivot = (mouse - pivot()) * followStrength / 100.f;
@@ -33,9 +33,13 @@ auto Eye::render(float dt, Node *hovered, Node *selected) -> void
     return mousePivot;
   }();
 
-  dLoc.x = clampMouse.x;
-  dLoc.y = clampMouse.y;
+  dLoc().x = clampMouse.x;
+  dLoc().y = clampMouse.y;
+  AnimSprite::tick(dt);
+}
 
+auto Eye::render(float dt, Node *hovered, Node *selected) -> void
+{
   AnimSprite::render(dt, hovered, selected);
   if (selected == this)
   {
@@ -23,6 +23,7 @@ private:
 
   auto load(IStrm &) -> void final;
   auto render(float dt, Node *hovered, Node *selected) -> void final;
+  auto tick(float dt) -> void final;
   auto renderUi() -> void final;
   auto save(OStrm &) const -> void final;
   auto ingest(const glm::mat4 &projMat, glm::vec2 v) -> void final;
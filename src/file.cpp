@@ -1,7 +1,18 @@
 #include "file.hpp"
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <cerrno>
+#include <string>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 UniqueFile open_file(std::filesystem::path const &path, char const *mode) noexcept
 {
@@ -22,3 +33,126 @@ UniqueFile open_file(std::filesystem::path const &path, char const *mode) noexce
   return UniqueFile(std::fopen(path.c_str(), mode));
 #endif
 }
+
+bool replace_file(std::filesystem::path const &path, std::string_view data) noexcept
+{
+  // several threads and processes can replace the same file, each writes its own temporary
+  static auto seq = std::atomic<unsigned>{0};
+#ifdef _WIN32
+  auto const pid = static_cast<unsigned long>(GetCurrentProcessId());
+#else
+  auto const pid = static_cast<unsigned long>(::getpid());
+#endif
+  auto tmp = path;
+  tmp += "." + std::to_string(pid) + "-" + std::to_string(seq++) + ".tmp";
+  auto const written = [&]() {
+    auto fp = open_file(tmp, "wb");
+    if (!fp)
+      return false;
+    if (std::fwrite(data.data(), 1, data.size(), fp.get()) != data.size() || std::fflush(fp.get()) != 0)
+      return false;
+#ifdef _WIN32
+    return _commit(_fileno(fp.get())) == 0;
+#else
+    return ::fsync(::fileno(fp.get())) == 0;
+#endif
+  }();
+  std::error_code ec;
+  if (written)
+  {
+    std::filesystem::rename(tmp, path, ec);
+    if (!ec)
+    {
+#ifndef _WIN32
+      // the rename itself is only durable once the directory entry is on the disk
+      auto dir = path.parent_path();
+      if (dir.empty())
+        dir = ".";
+      auto const fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+      if (fd < 0)
+        return false;
+      auto const synced = ::fsync(fd) == 0;
+      auto const err = errno;
+      ::close(fd);
+      errno = err;
+      return synced;
+#else
+      return true;
+#endif
+    }
+    errno = ec.value();
+  }
+  // the caller reports errno, removing the leftover must not clobber it
+  auto const err = errno;
+  std::filesystem::remove(tmp, ec);
+  errno = err;
+  return false;
+}
+
+MappedFile::MappedFile(std::filesystem::path const &path) noexcept
+{
+#ifdef _WIN32
+  auto const file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return;
+  LARGE_INTEGER sz;
+  if (!GetFileSizeEx(file, &sz))
+  {
+    CloseHandle(file);
+    return;
+  }
+  size_ = static_cast<std::size_t>(sz.QuadPart);
+  if (size_ > 0)
+  {
+    // the mapping keeps the file open on its own
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+      return;
+    data_ = static_cast<char const *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data_)
+      return;
+  }
+  else
+    CloseHandle(file);
+  ok = true;
+#else
+  auto const fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+  struct stat st;
+  if (::fstat(fd, &st) != 0)
+  {
+    ::close(fd);
+    return;
+  }
+  size_ = static_cast<std::size_t>(st.st_size);
+  if (size_ > 0)
+  {
+    auto const p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file open on its own
+    ::close(fd);
+    if (p == MAP_FAILED)
+      return;
+    data_ = static_cast<char const *>(p);
+    // the loaders read front to back
+    ::madvise(p, size_, MADV_SEQUENTIAL);
+  }
+  else
+    ::close(fd);
+  ok = true;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+  if (data_)
+    UnmapViewOfFile(data_);
+  if (mapping)
+    CloseHandle(mapping);
+#else
+  if (data_)
+    ::munmap(const_cast<char *>(data_), size_);
+#endif
+}
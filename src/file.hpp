@@ -3,6 +3,7 @@
 #include <cstdio>
 #include <filesystem>
 #include <memory>
+#include <string_view>
 
 struct FileDeleter
 {
@@ -13,3 +14,29 @@ using UniqueFile = std::unique_ptr<std::FILE, FileDeleter>;
 
 // just like fopen, return null on error setting errno
 UniqueFile open_file(std::filesystem::path const &path, char const *mode) noexcept;
+
+// writes a temporary file next to path, flushes it to the disk and renames it over path, so a crash
+// leaves either the old or the new content; returns false on error
+bool replace_file(std::filesystem::path const &path, std::string_view data) noexcept;
+
+// read-only view of a whole file, evaluates to false when the file cannot be opened
+class MappedFile
+{
+public:
+  MappedFile(std::filesystem::path const &path) noexcept;
+  MappedFile(MappedFile const &) = delete;
+  MappedFile &operator=(MappedFile const &) = delete;
+  ~MappedFile();
+
+  explicit operator bool() const noexcept { return ok; }
+  char const *data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+
+private:
+  char const *data_ = nullptr;
+  std::size_t size_ = 0;
+  bool ok = false;
+#ifdef _WIN32
+  void *mapping = nullptr;
+#endif
+};
@@ -1,5 +1,6 @@
 #include "font.hpp"
 #include "file.hpp"
+#include <algorithm>
 #include <spdlog/spdlog.h>
 
 namespace
@@ -27,6 +28,25 @@ void Font::FontDeleter::operator()(TTF_Font *ptr) const noexcept
   TTF_CloseFont(ptr);
 }
 
+namespace
+{
+  auto nextCodepoint(std::string_view &s) -> char32_t
+  {
+    const auto c = static_cast<unsigned char>(s.front());
+    const auto len = c < 0x80 ? 1U : (c >> 5) == 0x6 ? 2U : (c >> 4) == 0xe ? 3U : (c >> 3) == 0x1e ? 4U : 0U;
+    if (len == 0 || len > s.size())
+    {
+      s.remove_prefix(1);
+      return 0xfffd;
+    }
+    auto ret = static_cast<char32_t>(len == 1 ? c : c & (0x7f >> len));
+    for (auto i = 1U; i < len; ++i)
+      ret = (ret << 6) | (static_cast<unsigned char>(s[i]) & 0x3f);
+    s.remove_prefix(len);
+    return ret;
+  }
+} // namespace
+
 Font::Font(std::filesystem::path file, int ptsize)
   : file_(std::move(file)),
     ptsize_(ptsize),
@@ -38,7 +58,15 @@ Font::Font(std::filesystem::path file, int ptsize)
     }())
 {
   if (!font)
+  {
     SPDLOG_ERROR("TTF_OpenFont: {}", TTF_GetError());
+    return;
+  }
+  height = TTF_FontHeight(font.get());
+  atlasSide = 512;
+  while (atlasSide < 16 * height && atlasSide < 4096)
+    atlasSide *= 2;
+  resetAtlas();
 }
 
 Font::~Font()
@@ -47,68 +75,169 @@ Font::~Font()
 
 auto Font::render(glm::vec2 pos, const std::string &txt) -> void
 {
-  auto &tex = getTextureFromCache(txt);
+  if (!font)
+    return;
+
+  struct Quad
+  {
+    int x;
+    AtlasGlyph g;
+  };
+  auto quads = std::vector<Quad>{};
+  quads.reserve(txt.size());
+  // if the atlas fills up halfway through the string the glyphs placed before the reset are gone,
+  // lay the string out once more against the fresh atlas
+  for (auto pass = 0; pass < 2; ++pass)
+  {
+    const auto generation = atlasGeneration;
+    quads.clear();
+    auto x = 0;
+    auto prev = char32_t{0};
+    for (auto s = std::string_view{txt}; !s.empty();)
+    {
+      const auto ch = nextCodepoint(s);
+      if (prev)
+        x += getKerning(prev, ch);
+      const auto &m = getMetrics(ch);
+      const auto g = getAtlasGlyph(ch);
+      if (g.w > 0)
+        quads.push_back(Quad{x + m.xOffset, g});
+      x += m.advance;
+      prev = ch;
+    }
+    if (generation == atlasGeneration)
+      break;
+  }
+
+  const auto side = static_cast<float>(atlasSide);
   glEnable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, tex.texture());
+  glBindTexture(GL_TEXTURE_2D, atlas->texture());
   glBegin(GL_QUADS);
-  glTexCoord2f(.0f, .0f);
-  glVertex2f(pos.x, pos.y + tex.h());
-  glTexCoord2f(1.f, .0f);
-  glVertex2f(pos.x + tex.w(), pos.y + tex.h());
-  glTexCoord2f(1.f, 1.f);
-  glVertex2f(pos.x + tex.w(), pos.y);
-  glTexCoord2f(.0f, 1.f);
-  glVertex2f(pos.x, pos.y);
+  for (const auto &q : quads)
+  {
+    const auto u0 = q.g.x / side;
+    const auto u1 = (q.g.x + q.g.w) / side;
+    const auto v0 = q.g.y / side;
+    const auto v1 = (q.g.y + q.g.h) / side;
+    const auto x0 = pos.x + q.x;
+    const auto x1 = x0 + q.g.w;
+    const auto y1 = pos.y + height;
+    const auto y0 = y1 - q.g.h;
+    glTexCoord2f(u0, v0);
+    glVertex2f(x0, y1);
+    glTexCoord2f(u1, v0);
+    glVertex2f(x1, y1);
+    glTexCoord2f(u1, v1);
+    glVertex2f(x1, y0);
+    glTexCoord2f(u0, v1);
+    glVertex2f(x0, y0);
+  }
   glEnd();
   glBindTexture(GL_TEXTURE_2D, 0);
   glDisable(GL_TEXTURE_2D);
 }
 
-auto Font::getTextureFromCache(const std::string &txt) const -> Texture &
+auto Font::getMetrics(char32_t ch) const -> const Metrics &
 {
+  auto it = metrics.find(ch);
+  if (it != std::end(metrics))
+    return it->second;
+
+  auto ret = Metrics{};
+  int minx, maxx, miny, maxy, advance;
+  if (TTF_GlyphMetrics32(font.get(), ch, &minx, &maxx, &miny, &maxy, &advance) == 0)
   {
-    auto it = texturesCache.find(txt);
-    if (it != texturesCache.end())
-    {
-      cacheAge.erase(it->second.second);
-      cacheAge.push_back(txt);
-      it->second.second = std::end(cacheAge);
-      --it->second.second;
-      return it->second.first;
-    }
+    ret.advance = advance;
+    // SDL_ttf shifts the rendered glyph right when it extends left of the pen position
+    ret.xOffset = std::min(0, minx);
   }
+  return metrics.emplace(ch, ret).first->second;
+}
+
+auto Font::getKerning(char32_t prev, char32_t ch) const -> int
+{
+  const auto key = (static_cast<uint64_t>(prev) << 32) | ch;
+  auto it = kerning.find(key);
+  if (it != std::end(kerning))
+    return it->second;
+  const auto ret = TTF_GetFontKerningSizeGlyphs32(font.get(), prev, ch);
+  kerning.emplace(key, ret);
+  return ret;
+}
 
-  SDL_Surface *surface = TTF_RenderUTF8_Blended(font.get(), txt.c_str(), {255, 255, 255, 255});
+auto Font::getAtlasGlyph(char32_t ch) -> AtlasGlyph
+{
+  auto it = atlasGlyphs.find(ch);
+  if (it != std::end(atlasGlyphs))
+    return it->second;
+
+  auto ret = AtlasGlyph{};
+  auto surface = TTF_RenderGlyph32_Blended(font.get(), ch, {255, 255, 255, 255});
   if (!surface)
   {
-    SPDLOG_ERROR("TTF_RenderText_Blended: {}", TTF_GetError());
-    surface = SDL_CreateRGBSurfaceWithFormat(0,  // The flags are obsolete and should be set to 0.
-                                             16, //  The width in pixels of the surface to create.
-                                             16, //  The height in pixels of the surface to create.
-                                             32, // The depth in bits of the surface to create.
-                                             SDL_PIXELFORMAT_RGBA32);
+    SPDLOG_ERROR("TTF_RenderGlyph32_Blended: {}", TTF_GetError());
+    atlasGlyphs.emplace(ch, ret);
+    return ret;
+  }
+  if (surface->w >= atlasSide || surface->h >= atlasSide)
+  {
+    SDL_FreeSurface(surface);
+    atlasGlyphs.emplace(ch, ret);
+    return ret;
   }
 
-  auto tmp = texturesCache.emplace(txt, std::pair{surface, std::begin(cacheAge)});
-  assert(tmp.second);
-
-  SDL_FreeSurface(surface);
-  cacheAge.push_back(txt);
-  tmp.first->second.second = std::end(cacheAge);
-  --tmp.first->second.second;
-  while (cacheAge.size() > 200)
+  if (penX + surface->w > atlasSide)
   {
-    texturesCache.erase(cacheAge.front());
-    cacheAge.erase(std::begin(cacheAge));
+    penX = 0;
+    penY += rowH;
+    rowH = 0;
   }
-  return tmp.first->second.first;
+  if (penY + surface->h > atlasSide)
+    resetAtlas();
+
+  ret = AtlasGlyph{penX, penY, surface->w, surface->h};
+  glBindTexture(GL_TEXTURE_2D, atlas->texture());
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, surface->pitch / surface->format->BytesPerPixel);
+  glTexSubImage2D(
+    GL_TEXTURE_2D, 0, ret.x, ret.y, ret.w, ret.h, GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  SDL_FreeSurface(surface);
+
+  // one pixel gap so linear filtering does not bleed the neighbours in
+  penX += ret.w + 1;
+  rowH = std::max(rowH, ret.h + 1);
+  atlasGlyphs.emplace(ch, ret);
+  return ret;
 }
 
-auto Font::getSize(const std::string &txt) const -> glm::vec2
+auto Font::resetAtlas() -> void
 {
-  int w, h;
-  TTF_SizeUTF8(font.get(), txt.c_str(), &w, &h);
-  return glm::vec2{w, h};
+  auto surface = SDL_CreateRGBSurfaceWithFormat(0, atlasSide, atlasSide, 32, SDL_PIXELFORMAT_RGBA32);
+  atlas = std::make_unique<Texture>(surface);
+  SDL_FreeSurface(surface);
+  atlasGlyphs.clear();
+  penX = 0;
+  penY = 0;
+  rowH = 0;
+  ++atlasGeneration;
+}
+
+auto Font::getSize(std::string_view txt) const -> glm::vec2
+{
+  if (!font)
+    return glm::vec2{0.f, 0.f};
+  auto w = 0;
+  auto prev = char32_t{0};
+  for (auto s = txt; !s.empty();)
+  {
+    const auto ch = nextCodepoint(s);
+    if (prev)
+      w += getKerning(prev, ch);
+    w += getMetrics(ch).advance;
+    prev = ch;
+  }
+  return glm::vec2{w, height};
 }
 
 auto Font::file() const -> const std::filesystem::path &
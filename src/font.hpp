@@ -5,9 +5,11 @@
 #include <filesystem>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
-#include <list>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 class Font
 {
@@ -16,7 +18,7 @@ public:
   ~Font();
 
   auto render(glm::vec2, const std::string &) -> void;
-  auto getSize(const std::string &) const -> glm::vec2;
+  auto getSize(std::string_view) const -> glm::vec2;
   auto file() const -> const std::filesystem::path &;
   auto ptsize() const -> int;
 
@@ -26,11 +28,37 @@ private:
     void operator()(TTF_Font *ptr) const noexcept;
   };
 
+  struct Metrics
+  {
+    int advance = 0;
+    int xOffset = 0;
+  };
+
+  // location of a rasterized glyph in the atlas, in pixels
+  struct AtlasGlyph
+  {
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+  };
+
   std::filesystem::path file_;
   int ptsize_;
   std::unique_ptr<TTF_Font, FontDeleter> font;
-  mutable std::unordered_map<std::string, std::pair<Texture, std::list<std::string>::iterator>> texturesCache;
-  mutable std::list<std::string> cacheAge;
+  int height = 0;
+  mutable std::unordered_map<char32_t, Metrics> metrics;
+  mutable std::unordered_map<uint64_t, int> kerning;
+  int atlasSide = 0;
+  std::unique_ptr<Texture> atlas;
+  std::unordered_map<char32_t, AtlasGlyph> atlasGlyphs;
+  int penX = 0;
+  int penY = 0;
+  int rowH = 0;
+  int atlasGeneration = 0;
 
-  auto getTextureFromCache(const std::string &text) const -> Texture &;
+  auto getMetrics(char32_t) const -> const Metrics &;
+  auto getKerning(char32_t prev, char32_t) const -> int;
+  auto getAtlasGlyph(char32_t) -> AtlasGlyph;
+  auto resetAtlas() -> void;
 };
@@ -7,24 +7,40 @@
 #include <cctype>
 #include <cstring>
 #include <functional>
-#include <numeric>
 
 #include <rapidjson/document.h>
-#include <scn/scn.h>
 #include <spdlog/spdlog.h>
-#include <sstream>
 
-Gpt::Gpt(uv::Uv &uv, std::string aToken, HttpClient &aHttpClient)
+struct Gpt::Reply
+{
+  bool embedName = false;
+  std::vector<std::pair<Msg, Callback>> qMsgs;
+  std::string jsonPrompt;
+  std::chrono::steady_clock::time_point sent;
+  long httpStatus = 0;
+  std::string line;  // incomplete line of the event stream
+  std::string error; // body of a failed request
+  std::string text;  // completion streamed so far
+  size_t start = std::string::npos;
+  size_t delivered = 0; // end of the last sentence passed to the callback
+  std::string said;     // the sentences passed to the callback, they go to the history
+  bool rejected = false;
+};
+
+Gpt::Gpt(uv::Uv &uv, std::string aToken, std::string aUrl, HttpClient &aHttpClient)
   : timer(uv.createTimer()),
     token(std::move(aToken)),
     httpClient(aHttpClient),
     lastReply(std::chrono::high_resolution_clock::now())
 {
+  updateUrl(std::move(aUrl));
+  systemPrompt(std::move(systemPrompt_));
 }
 
-static auto esc(const std::string &str) -> std::string
+static auto esc(std::string_view str) -> std::string
 {
   std::string result;
+  result.reserve(str.size());
   for (auto c : str)
   {
     switch (c)
@@ -44,16 +60,27 @@ static auto esc(const std::string &str) -> std::string
 
 static std::string_view stripWhiteSpaces(std::string_view v)
 {
-  if (v.empty())
-    goto done;
-  while (std::isspace(v.front()))
+  while (!v.empty() && std::isspace(static_cast<unsigned char>(v.front())))
     v.remove_prefix(1);
-  while (std::isspace(v.back()))
+  while (!v.empty() && std::isspace(static_cast<unsigned char>(v.back())))
     v.remove_suffix(1);
-done:
   return v;
 }
 
+static auto countWords(std::string_view str) -> int
+{
+  auto count = 0;
+  auto inWord = false;
+  for (auto c : str)
+  {
+    const auto isSpace = std::isspace(static_cast<unsigned char>(c)) != 0;
+    if (!isSpace && !inWord)
+      ++count;
+    inWord = !isSpace;
+  }
+  return count;
+}
+
 static std::string_view stripHangingSentences(std::string_view v)
 {
   const auto posDot = v.rfind('.');
@@ -71,7 +98,10 @@ static std::string_view stripHangingSentences(std::string_view v)
 auto Gpt::prompt(std::string name, std::string p, Callback cb) -> void
 {
   p = stripWhiteSpaces(p);
-  queuedMsgs.emplace_back(std::make_pair(Msg{std::move(name), std::move(p)}, std::move(cb)));
+  auto msg = Msg{};
+  msg.name = std::move(name);
+  msg.msg = std::move(p);
+  queuedMsgs.emplace_back(std::move(msg), std::move(cb));
   using namespace std::chrono_literals;
   if (state == State::waiting || std::chrono::high_resolution_clock::now() < lastReply + 3s)
     return;
@@ -85,149 +115,228 @@ auto Gpt::process() -> void
   if (queuedMsgs.empty())
     return;
   state = State::waiting;
-  std::ostringstream ss;
   const auto embedName = (rand() % 5 == 0) || msgs.empty();
-  ss << R"({
+  for (const auto &msg : queuedMsgs)
+    remember(msg.first.name, msg.first.msg);
+
+  const auto head = std::string_view{R"({
     "model": "text-curie-001",
-    "prompt": ")";
-  ss << esc(systemPrompt_);
+    "prompt": ")"};
+  const auto tail = std::string_view{
+    R"(", "stream": true, "temperature": 1, "max_tokens": 24, "top_p": 1.0, "frequency_penalty": 0.5, "presence_penalty": 0.6, "stop": ["\n| "]})"};
+  std::string jsonPrompt;
+  jsonPrompt.reserve(head.size() + systemPromptJson.size() + msgsJsonSize + cohost_.size() + tail.size() + 8);
+  jsonPrompt += head;
+  jsonPrompt += systemPromptJson;
   for (const auto &msg : msgs)
-    ss << esc("\n| ") << esc(msg.name) << ": " << esc(msg.msg);
-  for (const auto &msg : queuedMsgs)
+    jsonPrompt += msg.json;
+  if (embedName)
   {
-    ss << esc("\n| ") << esc(msg.first.name) << ": " << esc(msg.first.msg);
-    msgs.emplace_back(std::move(msg.first));
+    jsonPrompt += R"(\n| )";
+    jsonPrompt += cohost_;
+    jsonPrompt += ':';
   }
-
-  if (embedName)
-    ss << R"(\n| )" << cohost_ << R"(:)";
   else
-    ss << R"(\n|)";
-  ss << R"(", "temperature": 1, "max_tokens": 24, "top_p": 1.0, "frequency_penalty": 0.5, "presence_penalty": 0.6, "stop": ["\n| "]})";
+    jsonPrompt += R"(\n|)";
+  jsonPrompt += tail;
 
-  httpClient.get().post(
-    "https://api.openai.com/v1/completions",
-    ss.str(),
-    [embedName, qMsgs = std::move(queuedMsgs), jsonPrompt = ss.str(), alive = weak_self()](
-      CURLcode code, long httpStatus, std::string payload) mutable {
-      if (auto self = alive.lock())
+  auto reply = std::make_shared<Reply>();
+  reply->embedName = embedName;
+  reply->qMsgs = std::move(queuedMsgs);
+  reply->jsonPrompt = jsonPrompt;
+  reply->sent = std::chrono::steady_clock::now();
+  auto stream = HttpClient::Stream{};
+  stream.onHeaders = [reply](long httpStatus, const HttpClient::Headers &) { reply->httpStatus = httpStatus; };
+  stream.onData = [reply, alive = weak_self()](std::string_view chunk) {
+    if (auto self = alive.lock())
+      self->onData(*reply, chunk);
+    else
+      SPDLOG_INFO("this was destroyed");
+    return true;
+  };
+  stream.onDone = [reply, alive = weak_self()](CURLcode code, long httpStatus) {
+    if (auto self = alive.lock())
+      self->onDone(*reply, code, httpStatus);
+    else
+      SPDLOG_INFO("this was destroyed");
+  };
+  httpClient.get().postStream(url + "/v1/completions",
+                              std::move(jsonPrompt),
+                              std::move(stream),
+                              {{"Content-Type", "application/json"}, {"Authorization", "Bearer " + token}});
+  queuedMsgs.clear();
+}
+
+auto Gpt::onData(Reply &r, std::string_view chunk) -> void
+{
+  if (r.httpStatus != 200)
+  {
+    r.error += chunk;
+    return;
+  }
+  // server-sent events, one JSON object per "data:" line:
+  // data: {"id": "cmpl-7PJIyTy1pXJD3OvzekQOQnqOdcUF5", "object": "text_completion", "created":
+  // 1686266764, "choices": [{"text": " Is", "index": 0, "logprobs": null, "finish_reason": null}],
+  // "model": "text-curie-001"}
+  // ...
+  // data: [DONE]
+  r.line += chunk;
+  for (auto eol = r.line.find('\n'); eol != std::string::npos; eol = r.line.find('\n'))
+  {
+    const auto l = stripWhiteSpaces(std::string_view{r.line}.substr(0, eol));
+    if (l.starts_with("data:"))
+    {
+      const auto data = stripWhiteSpaces(l.substr(5));
+      if (data != "[DONE]")
       {
-        if (code != CURLE_OK)
-        {
-          for (auto &msg : qMsgs)
-            msg.second("");
-          self->state = State::idle;
-          return;
-        }
-        if (httpStatus >= 400 && httpStatus < 500)
-        {
-          SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
-          SPDLOG_INFO("{}", jsonPrompt);
-          self->lastError = payload;
-          for (auto &msg : qMsgs)
-            msg.second("");
-          self->state = State::idle;
-          return;
-        }
-        if (httpStatus != 200)
+        rapidjson::Document document;
+        document.Parse(data.data(), data.size());
+        if (!document.HasParseError() && document.IsObject() && document.HasMember("choices") &&
+            document["choices"].IsArray() && !document["choices"].Empty())
         {
-          SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
-          SPDLOG_INFO("{}", jsonPrompt);
-          self->lastError = payload;
-          for (auto &msg : qMsgs)
-            msg.second("");
-          self->timer.start(
-            [alive]() {
-              if (auto self = alive.lock())
-              {
-                self->state = State::idle;
-                self->process();
-              }
-              else
-              {
-                SPDLOG_INFO("this was destroyed");
-              }
-            },
-            10'000);
-          return;
+          const auto &choice = document["choices"][0];
+          if (choice.IsObject() && choice.HasMember("text") && choice["text"].IsString())
+            r.text.append(choice["text"].GetString(), choice["text"].GetStringLength());
         }
-        self->lastError.clear();
-        rapidjson::Document document;
-        document.Parse(payload.data(), payload.size());
-        // {
-        //   "id": "cmpl-7PJIyTy1pXJD3OvzekQOQnqOdcUF5",
-        //   "object": "text_completion",
-        //   "created": 1686266764,
-        //   "model": "text-davinci-003",
-        //   "choices": [
-        //     {
-        //       "text": " Is this thing on?\n",
-        //       "index": 0,
-        //       "logprobs": null,
-        //       "finish_reason": "stop"
-        //     }
-        //   ],
-        //   "usage": {
-        //     "prompt_tokens": 58,
-        //     "completion_tokens": 6,
-        //     "total_tokens": 64
-        //   }
-        // }
-        auto const &choices = document["choices"].GetArray();
-        if (choices.Empty())
+      }
+    }
+    r.line.erase(0, eol + 1);
+  }
+  deliver(r, false);
+}
+
+auto Gpt::deliver(Reply &r, bool isFinal) -> void
+{
+  if (r.rejected)
+    return;
+  if (r.start == std::string::npos)
+  {
+    const auto lead = r.text.find_first_not_of(" \t\r\n");
+    if (lead == std::string::npos)
+    {
+      if (!isFinal)
+        return;
+      r.start = r.text.size();
+    }
+    else if (r.embedName)
+      r.start = lead;
+    else
+    {
+      // the name was not in the prompt, the reply has to be from the cohost to be used
+      const auto prefix = cohost_ + ":";
+      if (r.text.size() - lead < prefix.size() && !isFinal)
+        return;
+      if (r.text.compare(lead, prefix.size(), prefix) != 0)
+      {
+        r.rejected = true;
+        return;
+      }
+      r.start = lead + prefix.size();
+    }
+    r.delivered = r.start;
+  }
+
+  auto say = [&](std::string_view sentence) {
+    sentence = stripWhiteSpaces(sentence);
+    if (sentence.empty())
+      return;
+    if (r.said.empty())
+      SPDLOG_INFO("First sentence in {} ms",
+                  std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                        r.sent)
+                    .count());
+    else
+      r.said += ' ';
+    r.said += sentence;
+    r.qMsgs.front().second(sentence);
+  };
+
+  // a sentence is closed once its punctuation is followed by a white space
+  for (auto i = r.delivered; i + 1 < r.text.size(); ++i)
+  {
+    const auto c = r.text[i];
+    if ((c == '.' || c == '!' || c == '?') && std::isspace(static_cast<unsigned char>(r.text[i + 1])))
+    {
+      say(std::string_view{r.text}.substr(r.delivered, i + 1 - r.delivered));
+      r.delivered = i + 1;
+    }
+  }
+  if (!isFinal)
+    return;
+  // the tail can be cut by max_tokens, it is dropped unless the reply has nothing else
+  const auto rest = stripWhiteSpaces(std::string_view{r.text}.substr(r.delivered));
+  if (rest.find_first_of(".!?") != std::string_view::npos || r.said.empty())
+    say(stripHangingSentences(rest));
+  r.delivered = r.text.size();
+}
+
+auto Gpt::onDone(Reply &r, CURLcode code, long httpStatus) -> void
+{
+  auto &qMsgs = r.qMsgs;
+  if (code != CURLE_OK)
+  {
+    for (auto &msg : qMsgs)
+      msg.second("");
+    state = State::idle;
+    return;
+  }
+  if (httpStatus >= 400 && httpStatus < 500)
+  {
+    SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, r.error);
+    SPDLOG_INFO("{}", r.jsonPrompt);
+    lastError = r.error;
+    for (auto &msg : qMsgs)
+      msg.second("");
+    state = State::idle;
+    return;
+  }
+  if (httpStatus != 200)
+  {
+    SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, r.error);
+    SPDLOG_INFO("{}", r.jsonPrompt);
+    lastError = r.error;
+    for (auto &msg : qMsgs)
+      msg.second("");
+    timer.start(
+      [alive = weak_self()]() {
+        if (auto self = alive.lock())
         {
-          SPDLOG_INFO("{} {} {}", curl_easy_strerror(code), httpStatus, payload);
-          self->lastError = "0 Choices";
-          for (auto &msg : qMsgs)
-            msg.second("");
           self->state = State::idle;
           self->process();
         }
-        auto cohostMsg = stripHangingSentences(stripWhiteSpaces(std::string_view{choices[0]["text"].GetString(), choices[0]["text"].GetStringLength()}));
-        if (!embedName)
+        else
         {
-          if (cohostMsg.find(self->cohost_ + std::string{":"}) != 0)
-          {
-            for (auto &msg : qMsgs)
-              msg.second("");
-            self->state = State::idle;
-            self->process();
-            return;
-          }
-          cohostMsg = stripWhiteSpaces(cohostMsg.substr(self->cohost_.size() + 1));
+          SPDLOG_INFO("this was destroyed");
         }
+      },
+      10'000);
+    return;
+  }
+  lastError.clear();
+  deliver(r, true);
+  if (r.rejected || r.said.empty())
+  {
+    if (!r.rejected)
+    {
+      SPDLOG_INFO("{} {} empty reply", curl_easy_strerror(code), httpStatus);
+      lastError = "0 Choices";
+    }
+    for (auto &msg : qMsgs)
+      msg.second("");
+    state = State::idle;
+    process();
+    return;
+  }
 
-        {
-          Msg msg;
-          msg.name = self->cohost_;
-          msg.msg = cohostMsg;
-          self->msgs.emplace_back(std::move(msg));
-        }
-        const auto MaxTokens = 2048 * 4 / 10;
-        const auto initWords = self->countWords();
-        for (auto words = initWords; words > MaxTokens;)
-        {
-          words -= self->countWords(self->msgs.front());
-          self->msgs.pop_front();
-        }
-        for (auto i = 0U; i < qMsgs.size(); ++i)
-        {
-          if (i == 0)
-            qMsgs[i].second(cohostMsg);
-          else
-            qMsgs[i].second("");
-        }
-        self->state = State::idle;
-        self->lastReply = std::chrono::high_resolution_clock::now();
-        self->process();
-      }
-      else
-      {
-        SPDLOG_INFO("this was destroyed");
-      }
-    },
-    {{"Content-Type", "application/json"}, {"Authorization", "Bearer " + token}});
-  queuedMsgs.clear();
+  remember(cohost_, r.said);
+  const auto MaxTokens = 2048 * 4 / 10;
+  while (msgsWords > MaxTokens)
+    forget();
+  for (auto &msg : qMsgs)
+    msg.second("");
+  state = State::idle;
+  lastReply = std::chrono::high_resolution_clock::now();
+  process();
 }
 
 auto Gpt::updateToken(std::string aToken) -> void
@@ -235,27 +344,34 @@ auto Gpt::updateToken(std::string aToken) -> void
   token = std::move(aToken);
 }
 
-auto Gpt::countWords() const -> int
+auto Gpt::updateUrl(std::string v) -> void
 {
-  return std::accumulate(
-    std::begin(msgs), std::end(msgs), 0, [this](int a, const auto &msg) { return a + countWords(msg); });
+  while (!v.empty() && v.back() == '/')
+    v.pop_back();
+  url = std::move(v);
 }
 
-auto Gpt::countWords(const Msg &msg) const -> int
+auto Gpt::remember(std::string name, std::string msg) -> void
 {
-  std::string_view str = msg.msg;
+  auto &m = msgs.emplace_back();
+  m.json = esc("\n| ") + esc(name) + ": " + esc(msg);
+  m.words = countWords(msg);
+  m.name = std::move(name);
+  m.msg = std::move(msg);
+  msgsJsonSize += m.json.size();
+  msgsWords += m.words;
+}
 
-  std::size_t count = 0;
-  while (auto result = scn::scan_value<std::string_view>(str))
-  {
-    str = result.range_as_string_view();
-    ++count;
-  }
-  return count;
+auto Gpt::forget() -> void
+{
+  msgsJsonSize -= msgs.front().json.size();
+  msgsWords -= msgs.front().words;
+  msgs.pop_front();
 }
 
 auto Gpt::systemPrompt(std::string v) -> void
 {
+  systemPromptJson = esc(v);
   systemPrompt_ = std::move(v);
 }
 
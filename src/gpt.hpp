@@ -6,18 +6,22 @@
 
 #include "shared_from_this.hpp"
 #include "uv.hpp"
+#include <curl/curl.h>
 
 class Gpt : public virtual enable_shared_from_this
 {
 public:
+  // the reply is streamed in and delivered one complete sentence per call, the last call has an
+  // empty string
   using Callback = std::move_only_function<void(std::string_view)>;
-  Gpt(uv::Uv &, std::string token, class HttpClient &);
+  Gpt(uv::Uv &, std::string token, std::string url, class HttpClient &);
   auto cohost() const -> std::string;
   auto cohost(std::string) -> void;
   auto prompt(std::string name, std::string msg, Callback) -> void;
   auto systemPrompt() const -> const std::string &;
   auto systemPrompt(std::string) -> void;
   auto updateToken(std::string token) -> void;
+  auto updateUrl(std::string) -> void;
 
   std::string lastError;
 
@@ -26,28 +30,41 @@ private:
   {
     std::string name;
     std::string msg;
+    // set once when the message enters the history
+    std::string json; // the escaped "\n| name: msg" line of the prompt
+    int words = 0;
   };
   enum class State {
     idle,
     waiting,
   };
 
+  struct Reply;
+
   uv::Timer timer;
   std::string token;
+  std::string url;
   std::string systemPrompt_ =
     R"(Clara is a virtual co-host for Mika's Twitch stream. She entertains
 the audience, keeps the energy high, and contributes to the fun
 atmosphere. She is funny and likes to make quirky jokes. She has
 extensive knowledge about games, game development, Unreal Engine, and
 C++.)";
+  std::string systemPromptJson;
   std::reference_wrapper<HttpClient> httpClient;
   std::vector<std::pair<Msg, Callback>> queuedMsgs;
   std::deque<Msg> msgs;
+  // running totals over msgs
+  size_t msgsJsonSize = 0;
+  int msgsWords = 0;
   State state = State::idle;
   std::chrono::high_resolution_clock::time_point lastReply;
   std::string cohost_ = "Clara";
 
-  auto countWords() const -> int;
-  auto countWords(const Msg &) const -> int;
+  auto forget() -> void;
   auto process() -> void;
+  auto remember(std::string name, std::string msg) -> void;
+  auto onData(Reply &, std::string_view) -> void;
+  auto onDone(Reply &, CURLcode, long httpStatus) -> void;
+  auto deliver(Reply &, bool isFinal) -> void;
 };
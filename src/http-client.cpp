@@ -3,11 +3,34 @@
 #endif
 
 #include "http-client.hpp"
+#include "trace.hpp"
 #include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <spdlog/spdlog.h>
 
 namespace
 {
+  constexpr auto MaxPooledHandles = size_t{16};
+  // a bogus Content-Length should not be able to allocate the whole RAM up front
+  constexpr auto MaxReserve = size_t{64} * 1024 * 1024;
+
+  auto iequals(std::string_view a, std::string_view b) -> bool
+  {
+    return std::equal(std::begin(a), std::end(a), std::begin(b), std::end(b), [](char x, char y) {
+      return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+  }
+
+  auto trim(std::string_view v) -> std::string_view
+  {
+    while (!v.empty() && std::isspace(static_cast<unsigned char>(v.front())))
+      v.remove_prefix(1);
+    while (!v.empty() && std::isspace(static_cast<unsigned char>(v.back())))
+      v.remove_suffix(1);
+    return v;
+  }
+
   class CurlInitializer
   {
   public:
@@ -28,14 +51,23 @@ namespace uv
 }
 
 HttpClient::HttpClient(uv::Uv &aUv)
-  : uv(aUv), timeout(aUv.createTimer()), multiHandle(curl_multi_init())
+  : uv(aUv), timeout(aUv.createTimer()), multiHandle([]() {
+      CurlInitializer::init();
+      return curl_multi_init();
+    }()),
+    share(curl_share_init())
 {
-  CurlInitializer::init();
 #pragma GCC diagnostic ignored "-Wdisabled-macro-expansion"
   curl_multi_setopt(multiHandle, CURLMOPT_SOCKETDATA, this);
   curl_multi_setopt(multiHandle, CURLMOPT_SOCKETFUNCTION, &HttpClient::socketFunc_);
   curl_multi_setopt(multiHandle, CURLMOPT_TIMERDATA, this);
   curl_multi_setopt(multiHandle, CURLMOPT_TIMERFUNCTION, HttpClient::startTimeout_);
+  curl_multi_setopt(multiHandle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+  // all the handles live on the loop thread, so the share needs no lock callbacks
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
 }
 
 auto HttpClient::startTimeout_(CURLM *multi, long timeout_ms, void *userp) -> int
@@ -50,7 +82,10 @@ auto HttpClient::socketFunc_(CURL *easy, curl_socket_t s, int action, void *user
 
 HttpClient::~HttpClient()
 {
+  for (auto handle : pool)
+    curl_easy_cleanup(handle);
   curl_multi_cleanup(multiHandle);
+  curl_share_cleanup(share);
 }
 
 auto HttpClient::socketFunc(CURL *, curl_socket_t s, int action, void *socketp) -> int
@@ -106,6 +141,7 @@ void HttpClient::destroySockContext(SockContext *context)
 
 auto HttpClient::checkMultiInfo() -> void
 {
+  TRACE_ZONE("HttpClient::checkMultiInfo");
   int pending;
 
   while (auto message = curl_multi_info_read(multiHandle, &pending))
@@ -118,19 +154,7 @@ auto HttpClient::checkMultiInfo() -> void
          "WARNING: The data the returned pointer points to will not survive
          calling curl_multi_cleanup, curl_multi_remove_handle or
          curl_easy_cleanup." */
-      auto easyHandle = message->easy_handle;
-
-      char *doneUrl;
-      curl_easy_getinfo(easyHandle, CURLINFO_EFFECTIVE_URL, &doneUrl);
-      CurlContext *ctx;
-      curl_easy_getinfo(easyHandle, CURLINFO_PRIVATE, &ctx);
-      long codep;
-      curl_easy_getinfo(easyHandle, CURLINFO_RESPONSE_CODE, &codep);
-      ctx->callback(message->data.result, codep, std::move(ctx->payloadOut));
-      curl_slist_free_all(ctx->headers);
-      delete ctx;
-      curl_multi_remove_handle(multiHandle, easyHandle);
-      curl_easy_cleanup(easyHandle);
+      finish(message->easy_handle, message->data.result);
       break;
     }
     case CURLMSG_NONE:
@@ -139,6 +163,39 @@ auto HttpClient::checkMultiInfo() -> void
   }
 }
 
+auto HttpClient::finish(CURL *easyHandle, CURLcode result) -> void
+{
+  CurlContext *ctx;
+  curl_easy_getinfo(easyHandle, CURLINFO_PRIVATE, &ctx);
+  long codep = 0;
+  curl_easy_getinfo(easyHandle, CURLINFO_RESPONSE_CODE, &codep);
+  long newConnections = 0;
+  curl_easy_getinfo(easyHandle, CURLINFO_NUM_CONNECTS, &newConnections);
+  curl_off_t connectUs = 0;
+  curl_easy_getinfo(easyHandle, CURLINFO_APPCONNECT_TIME_T, &connectUs);
+  if (connectUs == 0)
+    curl_easy_getinfo(easyHandle, CURLINFO_CONNECT_TIME_T, &connectUs);
+  ++stats_.requests;
+  if (newConnections == 0)
+    ++stats_.reused;
+  else
+    stats_.handshakeUs += static_cast<uint64_t>(connectUs);
+  curl_multi_remove_handle(multiHandle, easyHandle);
+  active.erase(ctx->id);
+  if (pool.size() < MaxPooledHandles)
+  {
+    curl_easy_reset(easyHandle);
+    pool.push_back(easyHandle);
+  }
+  else
+    curl_easy_cleanup(easyHandle);
+  auto stream = std::move(ctx->stream);
+  curl_slist_free_all(ctx->headers);
+  delete ctx;
+  if (stream.onDone)
+    stream.onDone(result, codep);
+}
+
 void HttpClient::curlPerform(uv_poll_t *req, int /*status*/, int events)
 {
   auto context = static_cast<SockContext *>(req->data);
@@ -183,16 +240,32 @@ auto HttpClient::startTimeout(long timeoutMs, CURLM *multi) -> int
   return 0;
 }
 
-auto HttpClient::get(const std::string &url, Callback cb, const Headers &headers) -> void
+auto HttpClient::acquire(const std::string &url, Stream stream, const Headers &headers) -> CurlContext *
 {
-  auto handle = curl_easy_init();
+  auto handle = [this]() {
+    if (pool.empty())
+      return curl_easy_init();
+    auto ret = pool.back();
+    pool.pop_back();
+    return ret;
+  }();
   auto ctx = new CurlContext;
   ctx->self = this;
-  ctx->callback = std::move(cb);
+  ctx->id = nextId++;
+  ctx->handle = handle;
+  ctx->stream = std::move(stream);
+  active.emplace(ctx->id, handle);
   curl_easy_setopt(handle, CURLOPT_PRIVATE, ctx);
   curl_easy_setopt(handle, CURLOPT_WRITEDATA, ctx);
   curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, CurlContext::write_);
+  curl_easy_setopt(handle, CURLOPT_HEADERDATA, ctx);
+  curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, CurlContext::header_);
   curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(handle, CURLOPT_SHARE, share);
+  curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+  // rather wait for a connection that can take one more stream than open a new one
+  curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+  curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
 #ifdef _WIN32
   curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0L);
 #endif
@@ -203,7 +276,142 @@ auto HttpClient::get(const std::string &url, Callback cb, const Headers &headers
         ctx->headers, (h.first + ":" + (!h.second.empty() ? (" " + h.second) : "")).c_str());
     curl_easy_setopt(handle, CURLOPT_HTTPHEADER, ctx->headers);
   }
-  curl_multi_add_handle(multiHandle, handle);
+  return ctx;
+}
+
+auto HttpClient::buffered(Callback cb) -> Stream
+{
+  struct State
+  {
+    Callback callback;
+    std::string payload;
+  };
+  auto state = std::make_shared<State>();
+  state->callback = std::move(cb);
+  auto ret = Stream{};
+  ret.onHeaders = [state](long, const Headers &headers) {
+    for (const auto &h : headers)
+    {
+      if (!iequals(h.first, "Content-Length"))
+        continue;
+      auto len = size_t{};
+      const auto &v = h.second;
+      if (std::from_chars(v.data(), v.data() + v.size(), len).ec == std::errc{})
+        state->payload.reserve(std::min(len, MaxReserve));
+    }
+  };
+  ret.onData = [state](std::string_view chunk) {
+    state->payload += chunk;
+    return true;
+  };
+  ret.onDone = [state](CURLcode code, long httpStatus) {
+    state->callback(code, httpStatus, std::move(state->payload));
+  };
+  return ret;
+}
+
+auto HttpClient::get(const std::string &url, Callback cb, const Headers &headers) -> void
+{
+  getStream(url, buffered(std::move(cb)), headers);
+}
+
+auto HttpClient::post(const std::string &url, std::string post, Callback cb, const Headers &headers)
+  -> void
+{
+  postStream(url, std::move(post), buffered(std::move(cb)), headers);
+}
+
+auto HttpClient::getStream(const std::string &url, Stream stream, const Headers &headers) -> StreamId
+{
+  auto ctx = acquire(url, std::move(stream), headers);
+  curl_multi_add_handle(multiHandle, ctx->handle);
+  return ctx->id;
+}
+
+auto HttpClient::postStream(const std::string &url, std::string post, Stream stream, const Headers &headers)
+  -> StreamId
+{
+  auto ctx = acquire(url, std::move(stream), headers);
+  ctx->payloadIn = std::move(post);
+  curl_easy_setopt(ctx->handle, CURLOPT_READDATA, ctx);
+  curl_easy_setopt(ctx->handle, CURLOPT_READFUNCTION, CurlContext::read_);
+  curl_easy_setopt(ctx->handle, CURLOPT_POST, 1L);
+  curl_easy_setopt(
+    ctx->handle, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(ctx->payloadIn.size()));
+  curl_multi_add_handle(multiHandle, ctx->handle);
+  return ctx->id;
+}
+
+auto HttpClient::postUpload(const std::string &url, std::string head, Callback cb, const Headers &headers)
+  -> StreamId
+{
+  auto ctx = acquire(url, buffered(std::move(cb)), headers);
+  ctx->payloadIn = std::move(head);
+  ctx->uploading = true;
+  curl_easy_setopt(ctx->handle, CURLOPT_READDATA, ctx);
+  curl_easy_setopt(ctx->handle, CURLOPT_READFUNCTION, CurlContext::read_);
+  curl_easy_setopt(ctx->handle, CURLOPT_POST, 1L);
+  // no POSTFIELDSIZE, the length is unknown
+  curl_multi_add_handle(multiHandle, ctx->handle);
+  return ctx->id;
+}
+
+auto HttpClient::context(StreamId id) -> CurlContext *
+{
+  auto it = active.find(id);
+  if (it == std::end(active))
+    return nullptr;
+  CurlContext *ctx;
+  curl_easy_getinfo(it->second, CURLINFO_PRIVATE, &ctx);
+  return ctx;
+}
+
+auto HttpClient::append(StreamId id, std::string_view data) -> void
+{
+  auto ctx = context(id);
+  if (!ctx || !ctx->uploading)
+    return;
+  if (ctx->readPos == ctx->payloadIn.size())
+  {
+    // everything so far is sent, do not let the buffer grow with the whole recording
+    ctx->payloadIn.clear();
+    ctx->readPos = 0;
+  }
+  ctx->payloadIn += data;
+  if (ctx->sendPaused)
+  {
+    ctx->sendPaused = false;
+    curl_easy_pause(ctx->handle, CURLPAUSE_CONT);
+  }
+}
+
+auto HttpClient::endUpload(StreamId id) -> void
+{
+  auto ctx = context(id);
+  if (!ctx || !ctx->uploading)
+    return;
+  ctx->uploading = false;
+  if (ctx->sendPaused)
+  {
+    ctx->sendPaused = false;
+    curl_easy_pause(ctx->handle, CURLPAUSE_CONT);
+  }
+}
+
+auto HttpClient::resume(StreamId id) -> void
+{
+  auto it = active.find(id);
+  if (it == std::end(active))
+    return;
+  curl_easy_pause(it->second, CURLPAUSE_CONT);
+}
+
+auto HttpClient::cancel(StreamId id) -> void
+{
+  auto it = active.find(id);
+  if (it == std::end(active))
+    return;
+  finish(it->second, CURLE_ABORTED_BY_CALLBACK);
 }
 
 auto HttpClient::CurlContext::write_(char *in, unsigned size, unsigned nmemb, void *ctx) -> size_t
@@ -213,49 +421,65 @@ auto HttpClient::CurlContext::write_(char *in, unsigned size, unsigned nmemb, vo
 
 auto HttpClient::CurlContext::write(char *in, unsigned size, unsigned nmemb) -> size_t
 {
-  payloadOut += std::string_view{in, size * nmemb};
+  if (!headersDone)
+    finishHeaders();
+  if (stream.onData && !stream.onData(std::string_view{in, size * nmemb}))
+    return CURL_WRITEFUNC_PAUSE;
   return size * nmemb;
 }
 
-auto HttpClient::CurlContext::read(char *out, unsigned size, unsigned nmemb) -> size_t
+auto HttpClient::CurlContext::header_(char *in, unsigned size, unsigned nmemb, void *ctx) -> size_t
 {
-  const auto ret = std::min(static_cast<unsigned>(payloadIn.size()), size * nmemb);
-  std::copy(std::begin(payloadIn), std::begin(payloadIn) + ret, out);
-  payloadIn.erase(0, ret);
-  return ret;
+  return static_cast<CurlContext *>(ctx)->header(in, size, nmemb);
 }
 
-auto HttpClient::CurlContext::read_(char *out, unsigned size, unsigned nmemb, void *ctx) -> size_t
+auto HttpClient::CurlContext::header(char *in, unsigned size, unsigned nmemb) -> size_t
 {
-  return static_cast<CurlContext *>(ctx)->read(out, size, nmemb);
+  const auto line = trim(std::string_view{in, size * nmemb});
+  if (line.starts_with("HTTP/"))
+  {
+    // a new response, e.g. after 100 Continue
+    responseHeaders.clear();
+    headersDone = false;
+  }
+  else if (line.empty())
+  {
+    long status = 0;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status);
+    if (status >= 200)
+      finishHeaders();
+  }
+  else if (const auto colon = line.find(':'); colon != std::string_view::npos)
+    responseHeaders.emplace_back(std::string{trim(line.substr(0, colon))},
+                                 std::string{trim(line.substr(colon + 1))});
+  return size * nmemb;
 }
 
-auto HttpClient::post(const std::string &url, std::string post, Callback cb, const Headers &headers)
-  -> void
+auto HttpClient::CurlContext::finishHeaders() -> void
 {
-  auto handle = curl_easy_init();
-  auto ctx = new CurlContext;
-  ctx->self = this;
-  ctx->callback = std::move(cb);
-  ctx->payloadIn = std::move(post);
-  curl_easy_setopt(handle, CURLOPT_PRIVATE, ctx);
-  curl_easy_setopt(handle, CURLOPT_WRITEDATA, ctx);
-  curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, CurlContext::write_);
-  curl_easy_setopt(handle, CURLOPT_READDATA, ctx);
-  curl_easy_setopt(handle, CURLOPT_READFUNCTION, CurlContext::read_);
-  curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
-  curl_easy_setopt(handle, CURLOPT_POST, 1L);
-#ifdef _WIN32
-  curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0L);
-#endif
-  if (!headers.empty())
-  {
-    for (const auto &h : headers)
+  headersDone = true;
+  if (!stream.onHeaders)
+    return;
+  long status = 0;
+  curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status);
+  stream.onHeaders(status, responseHeaders);
+}
 
-      ctx->headers = curl_slist_append(
-        ctx->headers, (h.first + ":" + (!h.second.empty() ? (" " + h.second) : "")).c_str());
-    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, ctx->headers);
+auto HttpClient::CurlContext::read(char *out, unsigned size, unsigned nmemb) -> size_t
+{
+  const auto ret = std::min(payloadIn.size() - readPos, static_cast<size_t>(size) * nmemb);
+  if (ret == 0 && uploading)
+  {
+    // wait for append() or endUpload()
+    sendPaused = true;
+    return CURL_READFUNC_PAUSE;
   }
+  std::copy_n(std::begin(payloadIn) + static_cast<std::ptrdiff_t>(readPos), ret, out);
+  readPos += ret;
+  return ret;
+}
 
-  curl_multi_add_handle(multiHandle, handle);
+auto HttpClient::CurlContext::read_(char *out, unsigned size, unsigned nmemb, void *ctx) -> size_t
+{
+  return static_cast<CurlContext *>(ctx)->read(out, size, nmemb);
 }
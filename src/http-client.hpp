@@ -1,6 +1,9 @@
 #pragma once
+#include <cstdint>
 #include <functional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -19,20 +22,61 @@ class HttpClient : public virtual enable_shared_from_this
 public:
   using Headers = std::vector<std::pair<std::string, std::string>>;
   using Callback = std::move_only_function<void(CURLcode, long httpStatus, std::string payload)>;
+  using StreamId = uint64_t;
+
+  // callbacks of a streamed request, all of them are called on the loop thread
+  struct Stream
+  {
+    // the final status line and headers, before the first byte of the body
+    std::move_only_function<void(long httpStatus, const Headers &)> onHeaders;
+    // a piece of the body as it arrives; returning false pauses the transfer, the same piece is
+    // delivered again after resume()
+    std::move_only_function<bool(std::string_view)> onData;
+    std::move_only_function<void(CURLcode, long httpStatus)> onDone;
+  };
+
+  struct Stats
+  {
+    uint64_t requests = 0;
+    uint64_t reused = 0;      // finished without opening a new connection
+    uint64_t handshakeUs = 0; // total time spent connecting, including TLS, on the new connections
+  };
 
   HttpClient(uv::Uv &);
   HttpClient(const HttpClient &) = delete;
   ~HttpClient();
+  // buffered requests, the callback gets the whole body
   auto get(const std::string &url, Callback callback, const Headers &headers = Headers{}) -> void;
   auto post(const std::string &url,
             std::string post,
             Callback callback,
             const Headers &chunks = Headers{}) -> void;
+  auto getStream(const std::string &url, Stream, const Headers &headers = Headers{}) -> StreamId;
+  auto postStream(const std::string &url, std::string post, Stream, const Headers &headers = Headers{})
+    -> StreamId;
+  // a POST whose body is still being produced: it starts with head, append() adds to it and
+  // endUpload() completes it; sent chunked, the callback gets the whole response
+  auto postUpload(const std::string &url, std::string head, Callback, const Headers &headers = Headers{})
+    -> StreamId;
+  auto append(StreamId, std::string_view) -> void;
+  auto endUpload(StreamId) -> void;
+  // continues a transfer paused by onData, must not be called from inside onData
+  auto resume(StreamId) -> void;
+  // aborts the transfer, onDone is called with CURLE_ABORTED_BY_CALLBACK
+  auto cancel(StreamId) -> void;
+  auto stats() const -> const Stats & { return stats_; }
 
 private:
   std::reference_wrapper<uv::Uv> uv;
   uv::Timer timeout;
   CURLM *multiHandle = nullptr;
+  // DNS cache, TLS sessions and connections shared by all the requests
+  CURLSH *share = nullptr;
+  // finished easy handles are reset and kept, they hold on to their buffers and state
+  std::vector<CURL *> pool;
+  std::unordered_map<StreamId, CURL *> active;
+  StreamId nextId = 1;
+  Stats stats_;
   struct SockContext
   {
     HttpClient *self;
@@ -42,16 +86,28 @@ private:
   struct CurlContext
   {
     HttpClient *self;
+    StreamId id;
+    CURL *handle;
     std::string payloadIn;
-    std::string payloadOut;
+    size_t readPos = 0;
+    bool uploading = false;
+    bool sendPaused = false;
     curl_slist *headers = nullptr;
-    Callback callback;
+    Headers responseHeaders;
+    bool headersDone = false;
+    Stream stream;
     auto write(char *in, unsigned size, unsigned nmemb) -> size_t;
     static auto write_(char *in, unsigned size, unsigned nmemb, void *ctx) -> size_t;
     auto read(char *in, unsigned size, unsigned nmemb) -> size_t;
     static auto read_(char *out, unsigned size, unsigned nmemb, void *ctx) -> size_t;
-    auto done() -> void;
+    auto header(char *in, unsigned size, unsigned nmemb) -> size_t;
+    static auto header_(char *in, unsigned size, unsigned nmemb, void *ctx) -> size_t;
+    auto finishHeaders() -> void;
   };
+  auto acquire(const std::string &url, Stream, const Headers &) -> CurlContext *;
+  auto context(StreamId) -> CurlContext *;
+  static auto buffered(Callback) -> Stream;
+  auto finish(CURL *, CURLcode) -> void;
   auto checkMultiInfo() -> void;
   auto createSockContext(curl_socket_t sockfd) -> SockContext *;
   auto curlPerform(uv_poll_t *req, int status, int events) -> void;
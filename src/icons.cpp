@@ -0,0 +1,37 @@
+#include "icons.hpp"
+#include "lib.hpp"
+#include <cassert>
+
+Icons::Icons(Lib &lib)
+{
+  constexpr auto paths = std::array{
+    "engine:arrow-n-circle.png",
+    "engine:arrow-ne-circle.png",
+    "engine:arrow-e-circle.png",
+    "engine:arrow-se-circle.png",
+    "engine:arrow-s-circle.png",
+    "engine:arrow-sw-circle.png",
+    "engine:arrow-w-circle.png",
+    "engine:arrow-nw-circle.png",
+    "engine:center-circle.png",
+    "engine:select.png",
+    "engine:transalte.png",
+    "engine:scale.png",
+    "engine:rotate.png",
+    "engine:select-disabled.png",
+    "engine:transalte-disabled.png",
+    "engine:scale-disabled.png",
+    "engine:rotate-disabled.png",
+    "engine:eye-sprite.png",
+    "engine:not-visable.png",
+  };
+  static_assert(paths.size() == static_cast<size_t>(Icon::count));
+  for (auto i = 0U; i < paths.size(); ++i)
+    textures[i] = lib.queryTex(paths[i], true);
+}
+
+auto Icons::operator[](Icon v) const -> const Texture &
+{
+  assert(v < Icon::count);
+  return *textures[static_cast<size_t>(v)];
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory>
+
+class Texture;
+
+enum class Icon {
+  arrowN,
+  arrowNE,
+  arrowE,
+  arrowSE,
+  arrowS,
+  arrowSW,
+  arrowW,
+  arrowNW,
+  center,
+  select,
+  translate,
+  scale,
+  rotate,
+  selectDisabled,
+  translateDisabled,
+  scaleDisabled,
+  rotateDisabled,
+  hide,
+  show,
+  count
+};
+
+// Editor icons, loaded once and shared by all the nodes
+class Icons
+{
+public:
+  Icons(class Lib &);
+  auto operator[](Icon) const -> const Texture &;
+
+private:
+  std::array<std::shared_ptr<const Texture>, static_cast<size_t>(Icon::count)> textures;
+};
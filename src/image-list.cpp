@@ -25,7 +25,8 @@ auto ImageList::h() const -> float
 {
   if (textures.empty())
     return 100;
-  return textures.front()->h();
+  // only the current frame is guaranteed to be decoded
+  return textures[frame_ % textures.size()]->h();
 }
 
 auto ImageList::isTransparent(glm::vec2 v) const -> bool
@@ -35,8 +36,12 @@ auto ImageList::isTransparent(glm::vec2 v) const -> bool
 
   auto &texture = textures[frame_ % textures.size()];
 
+  if (!texture->isReady())
+    return true;
   if (texture->ch() == 3)
     return false;
+  if (w() <= 0 || h() <= 0)
+    return true;
   const auto x = static_cast<int>(v.x * texture->w() / w());
   const auto y = static_cast<int>(v.y * texture->h() / h());
   if (x < 0 || x >= texture->w() || y < 0 || y >= texture->h())
@@ -61,15 +66,32 @@ auto ImageList::numFrames() const -> int
   return static_cast<int>(textures.size());
 }
 
+auto ImageList::preload(int v) const -> void
+{
+  if (textures.empty())
+    return;
+  textures[v % textures.size()]->load();
+}
+
+auto ImageList::prefetch(int v) const -> void
+{
+  if (textures.empty())
+    return;
+  textures[v % textures.size()]->prefetch();
+}
+
 auto ImageList::render() -> void
 {
   if (textures.empty())
     return;
 
   auto &texture = textures[frame_ % textures.size()];
+  const auto tex = texture->texture();
+  if (!texture->isReady())
+    return;
 
   glEnable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, texture->texture());
+  glBindTexture(GL_TEXTURE_2D, tex);
   glBegin(GL_QUADS);
   glColor4f(1.f, 1.f, 1.f, 1.f);
   glTexCoord2f(.0f, .0f);
@@ -104,6 +126,15 @@ auto ImageList::renderUi() -> void
     ImGui::TextF("{} {}", n++, texture->path());
   }
   if (toDel >= 0)
+  {
+    // paths rather than the textures, so the history does not pin them in memory
+    auto oldPaths = std::vector<std::string>{};
+    auto pathsBytes = size_t{0};
+    for (const auto &t : textures)
+    {
+      oldPaths.emplace_back(t->path());
+      pathsBytes += sizeof(std::string) + oldPaths.back().capacity();
+    }
     undo.get().record(
       [alive = weak_self(), toDel]() {
         if (auto self = alive.lock())
@@ -115,16 +146,21 @@ auto ImageList::renderUi() -> void
           SPDLOG_INFO("this was destroyed");
         }
       },
-      [alive = weak_self(), oldTextures = textures]() {
+      [alive = weak_self(), oldPaths = std::move(oldPaths)]() {
         if (auto self = alive.lock())
         {
-          self->textures = std::move(oldTextures);
+          self->textures.clear();
+          for (const auto &path : oldPaths)
+            self->textures.emplace_back(self->lib.get().queryTex(path));
         }
         else
         {
           SPDLOG_INFO("this was destroyed");
         }
-      });
+      },
+      "",
+      pathsBytes);
+  }
   if (ImGui::Button("Add##Image"))
   {
     dialog = std::make_unique<FileOpen>(lib, "Add Image Dialog", [this](bool r, const auto &path) {
@@ -178,5 +214,11 @@ auto ImageList::w() const -> float
 {
   if (textures.empty())
     return 100;
-  return textures.front()->w();
+  return textures[frame_ % textures.size()]->w();
+}
+
+auto ImageList::textureRefs(std::vector<const std::shared_ptr<const Texture> *> &v) const -> void
+{
+  for (const auto &t : textures)
+    v.push_back(&t);
 }
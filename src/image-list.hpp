@@ -19,9 +19,14 @@ public:
   auto isTransparent(glm::vec2) const -> bool;
   auto load(IStrm &) -> void;
   auto numFrames() const -> int;
+  // decodes the frame in the background
+  auto preload(int frame) const -> void;
+  // the frame is about to be shown, it also has to be on the GPU
+  auto prefetch(int frame) const -> void;
   auto render() -> void;
   auto renderUi() -> void;
   auto save(OStrm &) const -> void;
+  auto textureRefs(std::vector<const std::shared_ptr<const Texture> *> &) const -> void;
   auto w() const -> float;
 
 private:
@@ -0,0 +1,245 @@
+#include "jobs.hpp"
+#include "trace.hpp"
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+namespace
+{
+  // queue of the worker running on this thread, so jobs submitted from a job stay local
+  thread_local const Jobs *currentJobs = nullptr;
+  thread_local size_t currentQueue = 0;
+} // namespace
+
+Jobs::Jobs(uv::Uv &uv, unsigned aThreads)
+  : async(uv.createAsync([this]() { deliver(); })), lastStats(std::chrono::steady_clock::now())
+{
+  for (auto i = 0U; i < aThreads + 1; ++i)
+    queues.emplace_back(std::make_unique<Queue>());
+  for (auto i = 0U; i < aThreads; ++i)
+    workers.emplace_back(std::make_unique<Worker>());
+  stats_.resize(aThreads);
+  for (auto i = 0U; i < aThreads; ++i)
+    threads.emplace_back([this, i]() { worker(i); });
+  SPDLOG_INFO("Started {} job workers", aThreads);
+}
+
+Jobs::~Jobs()
+{
+  drain();
+  {
+    auto lock = std::unique_lock{mutex};
+    stop = true;
+  }
+  wakeUp.notify_all();
+  threads.clear();
+}
+
+auto Jobs::submit(Task work, Task then) -> void
+{
+  ++pending;
+  auto job = [this, work = std::move(work), then = std::move(then)]() mutable {
+    work();
+    if (then)
+    {
+      {
+        auto lock = std::unique_lock{thenMutex};
+        thens.emplace_back(std::move(then));
+      }
+      async.send();
+    }
+    if (--pending == 0)
+    {
+      auto lock = std::unique_lock{mutex};
+      wakeUp.notify_all();
+    }
+  };
+
+  if (threads.empty())
+  {
+    job();
+    return;
+  }
+  const auto q = currentJobs == this ? currentQueue : nextQueue++ % threads.size();
+  push(q, std::move(job));
+}
+
+auto Jobs::push(size_t q, Task t) -> void
+{
+  {
+    auto &queue = *queues[q];
+    auto lock = std::unique_lock{queue.mutex};
+    queue.tasks.emplace_back(std::move(t));
+    ++queued;
+  }
+  {
+    // a worker between checking queued and going to sleep would miss the notification
+    auto lock = std::unique_lock{mutex};
+  }
+  // the loop thread waits on the same condition, waking just one could pick it
+  wakeUp.notify_all();
+}
+
+auto Jobs::run(std::vector<Task> &tasks) -> void
+{
+  if (tasks.empty())
+    return;
+  if (threads.empty() || tasks.size() == 1)
+  {
+    for (auto &t : tasks)
+      t();
+    return;
+  }
+
+  const auto self = queues.size() - 1;
+  auto left = std::atomic<size_t>{tasks.size()};
+  {
+    auto &queue = *queues[self];
+    auto lock = std::unique_lock{queue.mutex};
+    for (auto &t : tasks)
+      queue.tasks.emplace_back([this, &left, t = std::move(t)]() mutable {
+        t();
+        if (--left == 0)
+        {
+          auto lock = std::unique_lock{mutex};
+          wakeUp.notify_all();
+        }
+      });
+    queued += static_cast<int>(tasks.size());
+  }
+  {
+    auto lock = std::unique_lock{mutex};
+  }
+  wakeUp.notify_all();
+
+  // the calling thread takes only from its own queue, it should not get stuck in a long job
+  auto t = Task{};
+  for (;;)
+  {
+    {
+      auto &queue = *queues[self];
+      auto lock = std::unique_lock{queue.mutex};
+      if (queue.tasks.empty())
+        break;
+      t = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      --queued;
+    }
+    exec(self, t);
+  }
+
+  auto lock = std::unique_lock{mutex};
+  wakeUp.wait(lock, [&left]() { return left == 0; });
+}
+
+auto Jobs::pop(size_t self, Task &t) -> bool
+{
+  {
+    auto &q = *queues[self];
+    auto lock = std::unique_lock{q.mutex};
+    if (!q.tasks.empty())
+    {
+      t = std::move(q.tasks.back());
+      q.tasks.pop_back();
+      --queued;
+      return true;
+    }
+  }
+  // start with the queue of the loop thread, it is waiting for those
+  for (auto i = 0U; i < queues.size(); ++i)
+  {
+    const auto victim = (queues.size() - 1 + i) % queues.size();
+    if (victim == self)
+      continue;
+    auto &q = *queues[victim];
+    auto lock = std::unique_lock{q.mutex};
+    if (q.tasks.empty())
+      continue;
+    t = std::move(q.tasks.front());
+    q.tasks.pop_front();
+    --queued;
+    return true;
+  }
+  return false;
+}
+
+auto Jobs::exec(size_t self, Task &t) -> void
+{
+  if (self >= workers.size())
+  {
+    t();
+    t = nullptr;
+    return;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  t();
+  t = nullptr;
+  auto &w = *workers[self];
+  w.busyUs += static_cast<uint64_t>(
+    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+  ++w.jobs;
+}
+
+auto Jobs::worker(size_t self) -> void
+{
+  currentJobs = this;
+  currentQueue = self;
+  Trace::setThreadName(fmt::format("worker {}", self).c_str());
+  auto t = Task{};
+  for (;;)
+  {
+    if (pop(self, t))
+    {
+      exec(self, t);
+      continue;
+    }
+    auto lock = std::unique_lock{mutex};
+    wakeUp.wait(lock, [this]() { return stop || queued > 0; });
+    if (stop)
+      return;
+  }
+}
+
+auto Jobs::drain() -> void
+{
+  for (;;)
+  {
+    {
+      auto lock = std::unique_lock{mutex};
+      wakeUp.wait(lock, [this]() { return pending == 0; });
+    }
+    deliver();
+    // continuations can submit more jobs
+    if (pending == 0)
+      return;
+  }
+}
+
+auto Jobs::deliver() -> void
+{
+  TRACE_ZONE("Jobs::deliver");
+  auto tmp = std::vector<Task>{};
+  {
+    auto lock = std::unique_lock{thenMutex};
+    std::swap(tmp, thens);
+  }
+  for (auto &t : tmp)
+    t();
+}
+
+auto Jobs::stats() -> const std::vector<WorkerStats> &
+{
+  const auto now = std::chrono::steady_clock::now();
+  const auto elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(now - lastStats).count();
+  if (elapsedUs < 1'000'000)
+    return stats_;
+  lastStats = now;
+  for (auto i = 0U; i < workers.size(); ++i)
+  {
+    auto &w = *workers[i];
+    const auto busyUs = w.busyUs.load();
+    stats_[i].utilization = std::min(1.f, static_cast<float>(busyUs - w.lastBusyUs) / static_cast<float>(elapsedUs));
+    stats_[i].jobs = w.jobs;
+    w.lastBusyUs = busyUs;
+  }
+  return stats_;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "uv.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing job system. Every worker has its own queue and takes from the others when it runs
+// dry. Continuations of jobs are delivered back onto the loop thread.
+class Jobs
+{
+public:
+  using Task = std::move_only_function<void()>;
+
+  struct WorkerStats
+  {
+    float utilization = 0.f; // share of the last second spent running jobs
+    uint64_t jobs = 0;       // jobs finished since the start
+  };
+
+  Jobs(uv::Uv &, unsigned threads = std::max(std::thread::hardware_concurrency(), 2U) - 1U);
+  ~Jobs();
+
+  // runs work on a worker, then on the loop thread; jobs can submit more jobs
+  auto submit(Task work, Task then = nullptr) -> void;
+  // fork-join from the loop thread: runs the tasks on the workers and on the calling thread,
+  // returns when all of them are done
+  auto run(std::vector<Task> &) -> void;
+  // waits for the submitted jobs and runs their continuations on the calling thread; continuations
+  // can own GL objects, so the app calls it while its context is still current
+  auto drain() -> void;
+  auto size() const -> unsigned { return static_cast<unsigned>(threads.size()); }
+  auto stats() -> const std::vector<WorkerStats> &;
+
+private:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  struct Worker
+  {
+    std::atomic<uint64_t> busyUs = 0;
+    std::atomic<uint64_t> jobs = 0;
+    uint64_t lastBusyUs = 0;
+  };
+
+  uv::Async async;
+  std::mutex thenMutex;
+  std::vector<Task> thens;
+  // one per worker, the last one belongs to the loop thread
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<WorkerStats> stats_;
+  std::chrono::steady_clock::time_point lastStats;
+  std::mutex mutex;
+  std::condition_variable wakeUp;
+  std::atomic<int> queued = 0;  // submitted and not picked up yet
+  std::atomic<int> pending = 0; // submitted and not finished yet
+  std::atomic<unsigned> nextQueue = 0;
+  bool stop = false;
+  std::vector<std::jthread> threads;
+
+  auto push(size_t queue, Task) -> void;
+  auto pop(size_t self, Task &) -> bool;
+  auto exec(size_t self, Task &) -> void;
+  auto worker(size_t self) -> void;
+  auto deliver() -> void;
+};
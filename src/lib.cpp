@@ -1,14 +1,18 @@
 #include "lib.hpp"
 #include "preferences.hpp"
+#include <algorithm>
 #include <cassert>
 #include <spdlog/spdlog.h>
 
-Lib::Lib(class Preferences &aPreferences, uv::Uv &aUv, HttpClient &aHttpClient)
-  : preferences(aPreferences),
+Lib::Lib(class Preferences &aPreferences, uv::Uv &aUv, Jobs &aJobs, HttpClient &aHttpClient)
+  : preferences_(aPreferences),
     uv(aUv),
+    jobs(aJobs),
     httpClient(aHttpClient),
-    azureToken(preferences.get().azureKey, httpClient),
-    gpt_(uv, preferences.get().openAiToken, httpClient)
+    azureToken(uv, preferences_.get().azureKey, httpClient),
+    gpt_(uv, preferences_.get().openAiToken, preferences_.get().openAiUrl, httpClient),
+    physics_(transforms_),
+    icons_(*this)
 {
 }
 
@@ -16,13 +20,8 @@ auto Lib::queryTex(const std::string &v, bool isUi) -> std::shared_ptr<const Tex
 {
   auto it = textures.find(std::pair{v, isUi});
   if (it != std::end(textures))
-  {
-    auto shared = it->second.lock();
-    if (shared)
-      return shared;
-    textures.erase(it);
-  }
-  auto shared = std::make_shared<Texture>(uv, v, isUi);
+    return it->second;
+  auto shared = std::make_shared<Texture>(uv, jobs, v, isUi);
   [[maybe_unused]] auto tmp = textures.emplace(std::pair{v, isUi}, shared);
   assert(tmp.second);
   return shared;
@@ -39,7 +38,7 @@ auto Lib::queryTwitch(const std::string &v) -> std::shared_ptr<Twitch>
     twitchChannels.erase(it);
   }
   auto shared =
-    std::make_shared<Twitch>(uv, preferences.get().twitchUser, preferences.get().twitchKey, v);
+    std::make_shared<Twitch>(uv, preferences_.get().twitchUser, preferences_.get().twitchKey, v);
   [[maybe_unused]] auto tmp = twitchChannels.emplace(v, shared);
   assert(tmp.second);
   return shared;
@@ -68,17 +67,18 @@ auto Lib::flush() -> void
     auto shared = twitch.second.lock();
     if (!shared)
       continue;
-    shared->updateUserKey(preferences.get().twitchUser, preferences.get().twitchKey);
+    shared->updateUserKey(preferences_.get().twitchUser, preferences_.get().twitchKey);
   }
-  azureToken.updateKey(preferences.get().azureKey);
-  gpt_.updateToken(preferences.get().openAiToken);
+  azureToken.updateKey(preferences_.get().azureKey);
+  gpt_.updateToken(preferences_.get().openAiToken);
+  gpt_.updateUrl(preferences_.get().openAiUrl);
 }
 
 auto Lib::queryAzureTts(class AudioSink &audioSink) -> std::shared_ptr<AzureTts>
 {
   if (auto ret = azureTts.lock())
     return ret;
-  auto ret = std::make_shared<AzureTts>(uv, azureToken, httpClient, audioSink);
+  auto ret = std::make_shared<AzureTts>(uv, jobs, azureToken, httpClient, audioSink);
   azureTts = ret;
   return ret;
 }
@@ -96,3 +96,58 @@ auto Lib::gpt() -> Gpt &
 {
   return gpt_;
 }
+
+auto Lib::preferences() const -> const Preferences &
+{
+  return preferences_;
+}
+
+auto Lib::transforms() -> Transforms &
+{
+  return transforms_;
+}
+
+auto Lib::icons() const -> const Icons &
+{
+  return icons_;
+}
+
+auto Lib::physics() -> Physics &
+{
+  return physics_;
+}
+
+auto Lib::updateResidency() -> void
+{
+  Texture::nextFrame();
+  const auto ramBudget = static_cast<size_t>(std::max(0, preferences_.get().textureRamMb)) * 1024 * 1024;
+  const auto vramBudget = static_cast<size_t>(std::max(0, preferences_.get().textureVramMb)) * 1024 * 1024;
+  if (Texture::cpuBytes() <= ramBudget && Texture::gpuBytes() <= vramBudget)
+    return;
+
+  auto lru = std::vector<decltype(textures)::iterator>{};
+  for (auto it = std::begin(textures); it != std::end(textures); ++it)
+    if (!it->first.second)
+      lru.push_back(it);
+  std::sort(std::begin(lru), std::end(lru), [](const auto &a, const auto &b) {
+    return a->second->lastUse() < b->second->lastUse();
+  });
+
+  // only textures nobody references can be dropped, the rest keep their decoded image
+  auto evicted = std::vector<bool>(lru.size());
+  for (auto i = 0U; i < lru.size() && Texture::cpuBytes() > ramBudget; ++i)
+    if (lru[i]->second.use_count() == 1)
+    {
+      textures.erase(lru[i]);
+      evicted[i] = true;
+    }
+
+  // anything not drawn in the last frame can give up its GL texture
+  for (auto i = 0U; i < lru.size() && Texture::gpuBytes() > vramBudget; ++i)
+  {
+    if (evicted[i] || lru[i]->second->lastUse() + 1 >= Texture::frame())
+      continue;
+    if (lru[i]->second->evict())
+      SPDLOG_DEBUG("Evicted {} from the GPU", lru[i]->second->path());
+  }
+}
@@ -4,7 +4,10 @@
 #include "azure-tts.hpp"
 #include "font.hpp"
 #include "gpt.hpp"
+#include "icons.hpp"
+#include "physics.hpp"
 #include "texture.hpp"
+#include "transforms.hpp"
 #include "twitch.hpp"
 #include <filesystem>
 #include <map>
@@ -14,7 +17,7 @@
 class Lib
 {
 public:
-  Lib(class Preferences &, uv::Uv &, HttpClient &);
+  Lib(class Preferences &, uv::Uv &, class Jobs &, HttpClient &);
   auto flush() -> void;
   auto queryFont(const std::filesystem::path &path, int size) -> std::shared_ptr<Font>;
   auto queryTex(const std::string &, bool isUi = false) -> std::shared_ptr<const Texture>;
@@ -22,16 +25,28 @@ public:
   auto queryAzureTts(class AudioSink &) -> std::shared_ptr<AzureTts>;
   auto queryAzureStt() -> std::shared_ptr<AzureStt>;
   auto gpt() -> Gpt &;
+  auto preferences() const -> const Preferences &;
+  auto transforms() -> Transforms &;
+  auto icons() const -> const Icons &;
+  auto physics() -> Physics &;
+  // once per frame, keeps the textures within the memory budget from the preferences
+  auto updateResidency() -> void;
 
 private:
-  std::reference_wrapper<Preferences> preferences;
+  std::reference_wrapper<Preferences> preferences_;
   std::reference_wrapper<uv::Uv> uv;
+  std::reference_wrapper<Jobs> jobs;
   std::reference_wrapper<HttpClient> httpClient;
-  std::map<std::pair<std::string, bool>, std::weak_ptr<const Texture>> textures;
+  // textures stay here after the last node releases them, so undo and reopening a project do not
+  // decode them again, they are dropped least recently used first when over the budget
+  std::map<std::pair<std::string, bool>, std::shared_ptr<const Texture>> textures;
   std::unordered_map<std::string, std::weak_ptr<Twitch>> twitchChannels;
   std::map<std::pair<std::filesystem::path, int>, std::weak_ptr<Font>> fonts;
   AzureToken azureToken;
   std::weak_ptr<AzureTts> azureTts;
   std::weak_ptr<AzureStt> azureStt;
   Gpt gpt_;
+  Transforms transforms_;
+  Physics physics_;
+  Icons icons_;
 };
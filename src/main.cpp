@@ -4,8 +4,11 @@
 // folder + read the top of imgui.cpp. Read online: https://github.com/ocornut/imgui/tree/master/docs
 
 #include "app.hpp"
+#include "trace.hpp"
 #include <chrono>
 #include <filesystem>
+#include <string_view>
+#include <vector>
 #include <imgui.h>
 #include <spdlog/spdlog.h>
 #include <sdlpp/sdlpp.hpp>
@@ -24,6 +27,21 @@
 // Main code
 int main(int argc, char **argv)
 {
+  Trace::setThreadName("main");
+
+  // --trace=<file> writes the trace on exit, the rest is passed on to the app
+  auto traceFile = std::filesystem::path{};
+  auto args = std::vector<char *>{};
+  for (auto i = 0; i < argc; ++i)
+  {
+    using namespace std::literals;
+    const auto arg = std::string_view{argv[i]};
+    if (arg.starts_with("--trace="sv))
+      traceFile = std::filesystem::absolute(arg.substr(8));
+    else
+      args.push_back(argv[i]);
+  }
+
   // Setup SDL
   auto init = sdl::Init{SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_AUDIO};
   SDL_EventState(SDL_DROPFILE, SDL_ENABLE);
@@ -129,7 +147,7 @@ int main(int argc, char **argv)
     // style.Colors[ImGuiCol_ModalWindowDimBg] = ImVec4{0x6f / 255.f, 0x7d / 255.f, 0xaa / 255.f, 1.f};
   }
 
-  auto app = App{window, argc, argv};
+  auto app = App{window, static_cast<int>(args.size()), args.data()};
 
 #ifdef __EMSCRIPTEN__
   // For an Emscripten build we are disabling file-system access, so let's not attempt to do a fopen()
@@ -146,6 +164,8 @@ int main(int argc, char **argv)
 #ifdef __EMSCRIPTEN__
   EMSCRIPTEN_MAINLOOP_END;
 #endif
+  if (!traceFile.empty())
+    Trace::dump(traceFile);
 
   return 0;
 }
@@ -48,11 +48,27 @@ auto Mouth<S, ClassName>::do_clone() const -> std::shared_ptr<Node>
 }
 
 template <typename S, typename ClassName>
-auto Mouth<S, ClassName>::render(float dt, Node *hovered, Node *selected) -> void
+auto Mouth<S, ClassName>::preload() const -> void
+{
+  for (const auto &v : viseme2Sprite)
+    sprite.preload(v.second);
+}
+
+template <typename S, typename ClassName>
+auto Mouth<S, ClassName>::tick(float /*dt*/) -> void
 {
   if (sprite.numFrames() > 0)
     sprite.frame(viseme2Sprite[viseme] % sprite.numFrames());
-  sprite.render();
+}
+
+template <typename S, typename ClassName>
+auto Mouth<S, ClassName>::render(float dt, Node *hovered, Node *selected) -> void
+{
+  // any viseme can come next, keep the whole set on the GPU
+  for (const auto &v : viseme2Sprite)
+    sprite.prefetch(v.second);
+  if (isOnScreen())
+    sprite.render();
   Node::render(dt, hovered, selected);
 }
 
@@ -1,12 +1,17 @@
 #include "node.hpp"
 #include "imgui-helpers.hpp"
+#include "jobs.hpp"
 #include "save-factory.hpp"
+#include "texture.hpp"
+#include "trace.hpp"
 #include "ui.hpp"
 #include "undo.hpp"
 #include <SDL_opengl.h>
 #include <algorithm>
+#include <fmt/std.h>
 #include <glm/glm.hpp>
 #include <limits>
+#include <map>
 #include <numbers>
 #include <spdlog/spdlog.h>
 
@@ -43,6 +48,9 @@ namespace Internal
   }
 } // namespace Internal
 
+// bump when the layout written by save() changes
+static constexpr auto NodeChunkVersion = uint32_t{1};
+
 static auto getModelViewMatrix() -> glm::mat4
 {
   GLfloat modelMatrixData[16];
@@ -50,6 +58,13 @@ static auto getModelViewMatrix() -> glm::mat4
   return glm::make_mat4(modelMatrixData);
 }
 
+static auto getProjectionMatrix() -> glm::mat4
+{
+  GLfloat projectionMatrixData[16];
+  glGetFloatv(GL_PROJECTION_MATRIX, projectionMatrixData);
+  return glm::make_mat4(projectionMatrixData);
+}
+
 static auto setModelViewMatrix(glm::mat4 v) -> void
 {
   glMatrixMode(GL_MODELVIEW);
@@ -59,15 +74,8 @@ static auto setModelViewMatrix(glm::mat4 v) -> void
 Node::Node(Lib &lib, Undo &undo, std::string name)
   : name(std::move(name)),
     undo(undo),
-    arrowN(lib.queryTex("engine:arrow-n-circle.png", true)),
-    arrowNE(lib.queryTex("engine:arrow-ne-circle.png", true)),
-    arrowE(lib.queryTex("engine:arrow-e-circle.png", true)),
-    arrowSE(lib.queryTex("engine:arrow-se-circle.png", true)),
-    arrowS(lib.queryTex("engine:arrow-s-circle.png", true)),
-    arrowSW(lib.queryTex("engine:arrow-sw-circle.png", true)),
-    arrowW(lib.queryTex("engine:arrow-w-circle.png", true)),
-    arrowNW(lib.queryTex("engine:arrow-nw-circle.png", true)),
-    center(lib.queryTex("engine:center-circle.png", true))
+    icons(lib.icons()),
+    transformSlot(lib.transforms())
 {
 }
 
@@ -75,37 +83,41 @@ Node::~Node() {}
 
 auto Node::renderAll(float dt, Node *hovered, Node *selected) -> void
 {
+  TRACE_ZONE("Node::renderAll");
   auto ns = Nodes{};
-  getAllNodesCalcModelView(ns);
+  auto &transforms = transformSlot.transforms();
+  transforms.clearOrder();
+  collectAll(ns, -1);
+  transforms.propagate(getModelViewMatrix());
+  transforms.cull(getProjectionMatrix());
 
   std::stable_sort(std::begin(ns), std::end(ns), [](const auto a, const auto b) {
-    return a.get().zOrder < b.get().zOrder;
+    return a.get().zOrder() < b.get().zOrder();
   });
 
   glPushMatrix();
   for (auto &n : ns)
   {
-    setModelViewMatrix(n.get().modelViewMat);
-    if (n.get().visible)
+    setModelViewMatrix(n.get().modelViewMat());
+    if (n.get().visible())
       n.get().render(dt, hovered, selected);
+    else if (&n.get() == selected)
+      // the selected node is the one H toggles, decoding every hidden node would undo the lazy loading
+      n.get().preload();
   }
   glPopMatrix();
 }
 
-auto Node::getAllNodesCalcModelView(Nodes &out) -> void
+auto Node::collectAll(Nodes &out, int parentIdx) -> void
 {
-  glPushMatrix();
-  // Apply transformations
-  glTranslatef(loc.x + dLoc.x, loc.y + dLoc.y, 0.0f);     // Move the sprite
-  glRotatef(rot + dRot, 0.0f, 0.0f, 1.0f);                // Rotate the sprite
-  glScalef(scale.x + dScale.x, scale.y + dScale.y, 1.0f); // Scale the sprite
-  glTranslatef(-pivot_.x, -pivot_.y, 0.0f);               // Move the pivot point back
-  modelViewMat = getModelViewMatrix();
-
+  if (lazy && visible())
+    loadLazy();
+  // the matrices are computed afterwards in one pass over the transform arrays
+  transformSlot.get<&Transforms::Page::size>() = glm::vec2{w(), h()};
+  const auto idx = transformSlot.transforms().pushOrder(transformSlot.id(), parentIdx);
   out.push_back(*this);
   for (auto &n : nodes)
-    n->getAllNodesCalcModelView(out);
-  glPopMatrix();
+    n->collectAll(out, idx);
 }
 
 auto Node::renderUi() -> void
@@ -118,7 +130,7 @@ auto Node::renderUi() -> void
   ImGui::TableNextColumn();
   Ui::textRj("Visible");
   ImGui::TableNextColumn();
-  Ui::checkbox(undo, "##Visible", visible);
+  Ui::checkbox(undo, "##Visible", visible());
 
   ImGui::TableNextColumn();
   Ui::textRj("Location");
@@ -126,14 +138,14 @@ auto Node::renderUi() -> void
 
   Ui::dragFloat(undo,
                 "X##XLoc",
-                loc.x,
+                loc().x,
                 1.f,
                 -std::numeric_limits<float>::max(),
                 std::numeric_limits<float>::max(),
                 "%.1f");
   Ui::dragFloat(undo,
                 "Y##YLoc",
-                loc.y,
+                loc().y,
                 1.f,
                 -std::numeric_limits<float>::max(),
                 std::numeric_limits<float>::max(),
@@ -158,7 +170,7 @@ auto Node::renderUi() -> void
   if (uniformScaling)
   {
     {
-      float avgScale = (scale.x + scale.y) / 2.0f;
+      float avgScale = (scale().x + scale().y) / 2.0f;
       if (ImGui::DragFloat("##X",
                            &avgScale,
                            0.01f,
@@ -170,17 +182,17 @@ auto Node::renderUi() -> void
           [avgScale, alive = weak_self()]() {
             if (auto self = alive.lock())
             {
-              self->scale.x = self->scale.y = avgScale;
+              self->scale().x = self->scale().y = avgScale;
             }
             else
             {
               SPDLOG_INFO("this was destroyed");
             }
           },
-          [oldScale = scale, alive = weak_self()]() {
+          [oldScale = scale(), alive = weak_self()]() {
             if (auto self = alive.lock())
             {
-              self->scale = oldScale;
+              self->scale() = oldScale;
             }
             else
             {
@@ -195,8 +207,8 @@ auto Node::renderUi() -> void
     {
       if (uniformScaling)
       {
-        float avgScale = (scale.x + scale.y) / 2.0f;
-        scale.x = scale.y = avgScale;
+        float avgScale = (scale().x + scale().y) / 2.0f;
+        scale().x = scale().y = avgScale;
       }
     }
   }
@@ -204,7 +216,7 @@ auto Node::renderUi() -> void
   {
     Ui::dragFloat(undo,
                   "X##X",
-                  scale.x,
+                  scale().x,
                   0.01f,
                   -std::numeric_limits<float>::max(),
                   std::numeric_limits<float>::max(),
@@ -214,13 +226,13 @@ auto Node::renderUi() -> void
     {
       if (uniformScaling)
       {
-        float avgScale = (scale.x + scale.y) / 2.0f;
-        scale.x = scale.y = avgScale;
+        float avgScale = (scale().x + scale().y) / 2.0f;
+        scale().x = scale().y = avgScale;
       }
     }
     Ui::dragFloat(undo,
                   "Y##Y",
-                  scale.y,
+                  scale().y,
                   0.01f,
                   -std::numeric_limits<float>::max(),
                   std::numeric_limits<float>::max(),
@@ -229,41 +241,41 @@ auto Node::renderUi() -> void
   ImGui::TableNextColumn();
   Ui::textRj("ZOrder");
   ImGui::TableNextColumn();
-  Ui::inputInt(undo, "##ZOrder", zOrder);
+  Ui::inputInt(undo, "##ZOrder", zOrder());
   ImGui::TableNextColumn();
   Ui::textRj("Pivot");
   ImGui::TableNextColumn();
   Ui::dragFloat(undo,
                 "X##XPivot",
-                pivot_.x,
+                pivot().x,
                 1.f,
                 -std::numeric_limits<float>::max(),
                 std::numeric_limits<float>::max(),
                 "%.1f");
   Ui::dragFloat(undo,
                 "Y##YPivot",
-                pivot_.y,
+                pivot().y,
                 1.f,
                 -std::numeric_limits<float>::max(),
                 std::numeric_limits<float>::max(),
                 "%.1f");
   const auto sz = 2 * ImGui::GetFontSize();
-  if (Ui::btnImg("nw", *arrowNW, sz, sz))
+  if (Ui::btnImg("nw", icons.get()[Icon::arrowNW], sz, sz))
     undo.get().record(
       [newPivot = glm::vec2{0, h()}, alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = newPivot;
+          self->pivot() = newPivot;
         }
         else
         {
           SPDLOG_INFO("this was destroyed");
         }
       },
-      [oldPivot = pivot_, alive = weak_self()]() {
+      [oldPivot = pivot(), alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = oldPivot;
+          self->pivot() = oldPivot;
         }
         else
         {
@@ -271,22 +283,22 @@ auto Node::renderUi() -> void
         }
       });
   ImGui::SameLine();
-  if (Ui::btnImg("n", *arrowN, sz, sz))
+  if (Ui::btnImg("n", icons.get()[Icon::arrowN], sz, sz))
     undo.get().record(
       [newPivot = glm::vec2{w() / 2, h()}, alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = newPivot;
+          self->pivot() = newPivot;
         }
         else
         {
           SPDLOG_INFO("this was destroyed");
         }
       },
-      [oldPivot = pivot_, alive = weak_self()]() {
+      [oldPivot = pivot(), alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = oldPivot;
+          self->pivot() = oldPivot;
         }
         else
         {
@@ -294,44 +306,44 @@ auto Node::renderUi() -> void
         }
       });
   ImGui::SameLine();
-  if (Ui::btnImg("ne", *arrowNE, sz, sz))
+  if (Ui::btnImg("ne", icons.get()[Icon::arrowNE], sz, sz))
     undo.get().record(
       [newPivot = glm::vec2{w(), h()}, alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = newPivot;
+          self->pivot() = newPivot;
         }
         else
         {
           SPDLOG_INFO("this was destroyed");
         }
       },
-      [oldPivot = pivot_, alive = weak_self()]() {
+      [oldPivot = pivot(), alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = oldPivot;
+          self->pivot() = oldPivot;
         }
         else
         {
           SPDLOG_INFO("this was destroyed");
         }
       });
-  if (Ui::btnImg("w", *arrowW, sz, sz))
+  if (Ui::btnImg("w", icons.get()[Icon::arrowW], sz, sz))
     undo.get().record(
       [newPivot = glm::vec2{0, h() / 2}, alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = newPivot;
+          self->pivot() = newPivot;
         }
         else
         {
           SPDLOG_INFO("this was destroyed");
         }
       },
-      [oldPivot = pivot_, alive = weak_self()]() {
+      [oldPivot = pivot(), alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = oldPivot;
+          self->pivot() = oldPivot;
         }
         else
         {
@@ -339,22 +351,22 @@ auto Node::renderUi() -> void
         }
       });
   ImGui::SameLine();
-  if (Ui::btnImg("c", *center, sz, sz))
+  if (Ui::btnImg("c", icons.get()[Icon::center], sz, sz))
     undo.get().record(
       [newPivot = glm::vec2{w() / 2, h() / 2}, alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = newPivot;
+          self->pivot() = newPivot;
         }
         else
         {
           SPDLOG_INFO("this was destroyed");
         }
       },
-      [oldPivot = pivot_, alive = weak_self()]() {
+      [oldPivot = pivot(), alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = oldPivot;
+          self->pivot() = oldPivot;
         }
         else
         {
@@ -362,44 +374,44 @@ auto Node::renderUi() -> void
         }
       });
   ImGui::SameLine();
-  if (Ui::btnImg("e", *arrowE, sz, sz))
+  if (Ui::btnImg("e", icons.get()[Icon::arrowE], sz, sz))
     undo.get().record(
       [newPivot = glm::vec2{w(), h() / 2}, alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = newPivot;
+          self->pivot() = newPivot;
         }
         else
         {
           SPDLOG_INFO("this was destroyed");
         }
       },
-      [oldPivot = pivot_, alive = weak_self()]() {
+      [oldPivot = pivot(), alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = oldPivot;
+          self->pivot() = oldPivot;
         }
         else
         {
           SPDLOG_INFO("this was destroyed");
         }
       });
-  if (Ui::btnImg("sw", *arrowSW, sz, sz))
+  if (Ui::btnImg("sw", icons.get()[Icon::arrowSW], sz, sz))
     undo.get().record(
       [newPivot = glm::vec2{0, 0}, alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = newPivot;
+          self->pivot() = newPivot;
         }
         else
         {
           SPDLOG_INFO("this was destroyed");
         }
       },
-      [oldPivot = pivot_, alive = weak_self()]() {
+      [oldPivot = pivot(), alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = oldPivot;
+          self->pivot() = oldPivot;
         }
         else
         {
@@ -407,22 +419,22 @@ auto Node::renderUi() -> void
         }
       });
   ImGui::SameLine();
-  if (Ui::btnImg("s", *arrowS, sz, sz))
+  if (Ui::btnImg("s", icons.get()[Icon::arrowS], sz, sz))
     undo.get().record(
       [newPivot = glm::vec2{w() / 2, 0}, alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = newPivot;
+          self->pivot() = newPivot;
         }
         else
         {
           SPDLOG_INFO("this was destroyed");
         }
       },
-      [oldPivot = pivot_, alive = weak_self()]() {
+      [oldPivot = pivot(), alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = oldPivot;
+          self->pivot() = oldPivot;
         }
         else
         {
@@ -430,22 +442,22 @@ auto Node::renderUi() -> void
         }
       });
   ImGui::SameLine();
-  if (Ui::btnImg("se", *arrowSE, sz, sz))
+  if (Ui::btnImg("se", icons.get()[Icon::arrowSE], sz, sz))
     undo.get().record(
       [newPivot = glm::vec2{w() / 2, 0}, alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = newPivot;
+          self->pivot() = newPivot;
         }
         else
         {
           SPDLOG_INFO("this was destroyed");
         }
       },
-      [oldPivot = pivot_, alive = weak_self()]() {
+      [oldPivot = pivot(), alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->pivot_ = oldPivot;
+          self->pivot() = oldPivot;
         }
         else
         {
@@ -455,7 +467,7 @@ auto Node::renderUi() -> void
   ImGui::TableNextColumn();
   Ui::textRj("Rotation");
   ImGui::TableNextColumn();
-  Ui::dragFloat(undo, "°##Rotation", rot, 1.f, -360.0f, 360.0f, "%.1f");
+  Ui::dragFloat(undo, "°##Rotation", rot(), 1.f, -360.0f, 360.0f, "%.1f");
 }
 
 static glm::vec3 mouseToModelViewCoords(glm::vec2 mouse,
@@ -488,7 +500,7 @@ auto Node::screenToLocal(const glm::mat4 &projMat, glm::vec2 screen) const -> gl
   const auto w = io.DisplaySize.x;
   const auto h = io.DisplaySize.y;
 
-  glm::mat4 mvpMatrix = projMat * modelViewMat;
+  glm::mat4 mvpMatrix = projMat * modelViewMat();
   glm::vec3 modelViewCoords = mouseToModelViewCoords(screen, glm::vec2{w, h}, mvpMatrix);
   return glm::vec2{modelViewCoords.x, modelViewCoords.y};
 }
@@ -499,7 +511,7 @@ auto Node::localToScreen(const glm::mat4 &projMat, glm::vec2 local) const -> glm
   const auto w = io.DisplaySize.x;
   const auto h = io.DisplaySize.y;
 
-  glm::mat4 mvpMatrix = projMat * modelViewMat;
+  glm::mat4 mvpMatrix = projMat * modelViewMat();
 
   glm::vec4 clipSpaceCoords = mvpMatrix * glm::vec4(local, 0.0f, 1.0f);
   clipSpaceCoords /= clipSpaceCoords.w; // Perspective division
@@ -518,7 +530,7 @@ auto Node::nodeUnder(const glm::mat4 &projMat, glm::vec2 v) -> Node *
   collectUnderNodes(projMat, v, underNodes);
 
   std::stable_sort(underNodes.begin(), underNodes.end(), [](const auto a, const auto b) {
-    return a.get().zOrder > b.get().zOrder;
+    return a.get().zOrder() > b.get().zOrder();
   });
 
   if (!underNodes.empty())
@@ -532,8 +544,8 @@ auto Node::collectUnderNodes(const glm::mat4 &projMat, glm::vec2 v, Nodes &under
     (*it)->collectUnderNodes(projMat, v, underNodes);
 
   auto localPos = screenToLocal(projMat, v);
-  if (!(localPos.x < 0.f || localPos.x > w() || localPos.y < 0.f || localPos.y > h() ||
-        isTransparent(localPos) || !visible))
+  if (!(!visible() || !isOnScreen() || localPos.x < 0.f || localPos.x > w() || localPos.y < 0.f || localPos.y > h() ||
+        isTransparent(localPos)))
     underNodes.push_back(*this);
 }
 
@@ -558,10 +570,10 @@ auto Node::render(float /*dt*/, Node *hovered, Node *selected) -> void
   if (selected != this)
     return;
   glBegin(GL_LINES);
-  glVertex2f(pivot_.x - d, pivot_.y - d);
-  glVertex2f(pivot_.x + d, pivot_.y + d);
-  glVertex2f(pivot_.x - d, pivot_.y + d);
-  glVertex2f(pivot_.x + d, pivot_.y - d);
+  glVertex2f(pivot().x - d, pivot().y - d);
+  glVertex2f(pivot().x + d, pivot().y + d);
+  glVertex2f(pivot().x - d, pivot().y + d);
+  glVertex2f(pivot().x + d, pivot().y - d);
   glEnd();
 }
 
@@ -668,7 +680,7 @@ auto Node::unparent() -> void
     [it, newParent, oldParent, alive = weak_self(), other]() {
       if (auto self = alive.lock())
       {
-        self->loc += oldParent->loc;
+        self->loc() += oldParent->loc();
         newParent->nodes.emplace_back(std::move(other));
         oldParent->nodes.erase(it);
         self->parent_ = newParent;
@@ -677,10 +689,10 @@ auto Node::unparent() -> void
         SPDLOG_INFO("this was destroyed");
       }
     },
-    [it, newParent, oldLoc = loc, oldParent, alive = weak_self(), other]() {
+    [it, newParent, oldLoc = loc(), oldParent, alive = weak_self(), other]() {
       if (auto self = alive.lock())
       {
-        self->loc = oldLoc;
+        self->loc() = oldLoc;
         auto it2 = std::find(std::begin(newParent->nodes), std::end(newParent->nodes), self);
         assert(it2 != std::end(newParent->nodes));
         newParent->nodes.erase(it2);
@@ -714,9 +726,9 @@ auto Node::parentWithBellow() -> void
     [newParent, alive = weak_self(), it, other]() {
       if (auto self = alive.lock())
       {
-        glm::mat4 newParentTransform = newParent->modelViewMat;
-        self->modelViewMat = glm::inverse(newParentTransform) * self->modelViewMat;
-        self->loc = glm::vec2{self->modelViewMat[3][0], self->modelViewMat[3][1]};
+        glm::mat4 newParentTransform = newParent->modelViewMat();
+        self->modelViewMat() = glm::inverse(newParentTransform) * self->modelViewMat();
+        self->loc() = glm::vec2{self->modelViewMat()[3][0], self->modelViewMat()[3][1]};
 
         newParent->nodes.emplace_back(std::move(other));
         self->parent_->nodes.erase(it);
@@ -727,10 +739,10 @@ auto Node::parentWithBellow() -> void
         SPDLOG_INFO("this was destroyed");
       }
     },
-    [it, newParent, oldLoc = loc, oldParent, alive = weak_self(), other]() {
+    [it, newParent, oldLoc = loc(), oldParent, alive = weak_self(), other]() {
       if (auto self = alive.lock())
       {
-        self->loc = oldLoc;
+        self->loc() = oldLoc;
         auto it2 = std::find(std::begin(newParent->nodes), std::end(newParent->nodes), self);
         assert(it2 != std::end(newParent->nodes));
         newParent->nodes.erase(it2);
@@ -756,6 +768,7 @@ auto Node::del(Node **ppNode) -> void
   auto it = std::find_if(
     parentNodes.begin(), parentNodes.end(), [&pNode](const auto &v) { return pNode == v.get(); });
   assert(it != parentNodes.end());
+  const auto pinnedBytes = pNode->subtreeTextureBytes();
   undo.record(
     [&parentNodes, it, ppNode]() {
       parentNodes.erase(it);
@@ -764,7 +777,9 @@ auto Node::del(Node **ppNode) -> void
     [&parentNodes, it, ppNode, spNode = std::move(*it)]() mutable {
       *ppNode = spNode.get();
       parentNodes.emplace(it, std::move(spNode));
-    });
+    },
+    "",
+    pinnedBytes);
 }
 
 auto Node::delNoUndo(Node &node) -> void
@@ -780,13 +795,13 @@ auto Node::delNoUndo(Node &node) -> void
 
 auto Node::translateCancel() -> void
 {
-  loc = initLoc;
+  loc() = initLoc;
 }
 
 auto Node::translateStart(glm::vec2 mouse) -> void
 {
   startMousePos = mouse;
-  initLoc = loc;
+  initLoc = loc();
   editMode_ = EditMode::translate;
 }
 
@@ -794,18 +809,18 @@ auto Node::translateUpdate(const glm::mat4 &projMat, glm::vec2 mouse) -> void
 {
   const auto startLoc = parent_ ? parent_->screenToLocal(projMat, startMousePos) : startMousePos;
   const auto endLoc = parent_ ? parent_->screenToLocal(projMat, mouse) : mouse;
-  loc = initLoc + endLoc - startLoc;
+  loc() = initLoc + endLoc - startLoc;
 }
 
 auto Node::rotCancel() -> void
 {
-  rot = initRot;
+  rot() = initRot;
 }
 
 auto Node::rotStart(glm::vec2 mouse) -> void
 {
   startMousePos = mouse;
-  initRot = rot;
+  initRot = rot();
   editMode_ = EditMode::rotate;
 }
 
@@ -816,24 +831,24 @@ auto Node::rotUpdate(const glm::mat4 &projMat, glm::vec2 mouse) -> void
 
   // Calculate the angles between the pivot and start/end locations
   const auto startAngle =
-    std::atan2(startLoc.y - pivot_.y, startLoc.x - pivot_.x) * 180.f / std::numbers::pi_v<float>;
+    std::atan2(startLoc.y - pivot().y, startLoc.x - pivot().x) * 180.f / std::numbers::pi_v<float>;
   const auto endAngle =
-    std::atan2(endLoc.y - pivot_.y, endLoc.x - pivot_.x) * 180.f / std::numbers::pi_v<float>;
+    std::atan2(endLoc.y - pivot().y, endLoc.x - pivot().x) * 180.f / std::numbers::pi_v<float>;
 
   // Calculate the rotation difference and update the rotation
   const auto rotDiff = endAngle - startAngle;
-  rot = initRot + rotDiff;
+  rot() = initRot + rotDiff;
 }
 
 auto Node::scaleCancel() -> void
 {
-  scale = initScale;
+  scale() = initScale;
 }
 
 auto Node::scaleStart(glm::vec2 mouse) -> void
 {
   startMousePos = mouse;
-  initScale = scale;
+  initScale = scale();
   editMode_ = EditMode::scale;
 }
 
@@ -844,16 +859,28 @@ auto Node::scaleUpdate(const glm::mat4 &projMat, glm::vec2 mouse) -> void
 
   // Calculate the scaling factor based on the distance between start and end locations
   const auto scaleFactor = glm::length(endLoc - pivot()) / glm::length(startLoc - pivot());
-  scale = initScale * scaleFactor;
+  scale() = initScale * scaleFactor;
 }
 
-auto Node::saveAll(OStrm &strm) const -> void
+auto Node::saveAll(Prj::Writer &writer, int32_t parent) const -> void
 {
-  save(strm);
-  auto sz = static_cast<int32_t>(nodes.size());
-  ::ser(strm, sz);
+  if (!savedChunk)
+  {
+    OStrm strm;
+    save(strm);
+    savedChunk = std::make_shared<const SavedChunk>(SavedChunk{strm.str(), Prj::crc32(strm.str())});
+  }
+  const auto flags = visible() ? 0U : (Prj::hidden | (isSubtreeHidden() ? Prj::subtreeHidden : 0U));
+  const auto idx = writer.add(Prj::ChunkType::node,
+                              NodeChunkVersion,
+                              parent,
+                              flags,
+                              savedChunk->payload,
+                              savedChunk->crc);
   for (const auto &n : nodes)
-    n->saveAll(strm);
+    n->saveAll(writer, idx);
+  if (lazy)
+    writer.splice(Prj::Reader{lazy->chunks.data(), lazy->chunks.data() + lazy->chunks.size()}, idx);
 }
 
 auto Node::loadAll(const class SaveFactory &saveFactory, IStrm &strm) -> void
@@ -878,14 +905,126 @@ auto Node::loadAll(const class SaveFactory &saveFactory, IStrm &strm) -> void
   }
 }
 
+auto Node::loadAll(const SaveFactory &saveFactory, const Prj::Reader &reader, Node *into) -> std::unique_ptr<Node>
+{
+  auto ret = std::unique_ptr<Node>{};
+  // null when the chunk was skipped or deferred
+  auto loaded = std::vector<Node *>(reader.size(), nullptr);
+  // the hidden node holding a deferred chunk and the chunk index in its writer
+  auto deferred = std::vector<std::pair<Node *, int32_t>>(reader.size(), {nullptr, -1});
+  auto writers = std::map<Node *, Prj::Writer>{};
+  for (auto i = 0U; i < reader.size(); ++i)
+  {
+    const auto &c = reader.chunk(i);
+    if (!reader.isValid(i))
+    {
+      SPDLOG_ERROR("Chunk {} is damaged, skipping it with its children", i);
+      continue;
+    }
+    auto parent = into;
+    if (c.parent >= 0)
+    {
+      const auto p = static_cast<size_t>(c.parent);
+      if (auto [owner, idx] = deferred[p]; owner)
+      {
+        deferred[i] = {owner, writers[owner].add(c.type, c.version, idx, c.flags, reader.payload(i))};
+        continue;
+      }
+      parent = loaded[p];
+      if (!parent)
+        continue;
+      // visibility is not inherited, a visible child of a hidden node is still drawn
+      if ((reader.chunk(p).flags & Prj::subtreeHidden) != 0)
+      {
+        deferred[i] = {parent, writers[parent].add(c.type, c.version, -1, c.flags, reader.payload(i))};
+        continue;
+      }
+    }
+    if (c.type != Prj::ChunkType::node)
+    {
+      SPDLOG_INFO("Skipping chunk {} of unknown type {:#x}", i, static_cast<uint32_t>(c.type));
+      continue;
+    }
+    if (c.version > NodeChunkVersion)
+    {
+      SPDLOG_ERROR("Chunk {} is version {}, newer than supported {}", i, c.version, NodeChunkVersion);
+      continue;
+    }
+    const auto payload = reader.payload(i);
+    IStrm strm(payload.data(), payload.data() + payload.size());
+    std::string className;
+    std::string name;
+    ::deser(strm, className);
+    ::deser(strm, name);
+    auto node = saveFactory.ctor(className, name);
+    if (!node)
+    {
+      SPDLOG_ERROR("Unknown class name {} name {}", className, name);
+      continue;
+    }
+    node->load(strm);
+    node->visible() = (c.flags & Prj::hidden) == 0;
+    loaded[i] = node.get();
+    if (parent)
+      parent->addChild(std::move(node));
+    else if (!ret)
+      ret = std::move(node);
+    else
+      SPDLOG_INFO("Skipping extra top level chunk {}", i);
+  }
+  for (auto &[owner, writer] : writers)
+  {
+    auto chunks = writer.str();
+    owner->lazy = std::make_shared<const Lazy>(Lazy{std::move(chunks), &saveFactory});
+  }
+  return ret;
+}
+
+auto Node::markDirtyAll() -> void
+{
+  markDirty();
+  for (auto &n : nodes)
+    n->markDirtyAll();
+}
+
+auto Node::loadLazy() -> void
+{
+  if (!lazy)
+    return;
+  const auto tmp = std::move(lazy);
+  lazy = nullptr;
+  try
+  {
+    loadAll(*tmp->saveFactory, Prj::Reader{tmp->chunks.data(), tmp->chunks.data() + tmp->chunks.size()}, this);
+  }
+  catch (std::runtime_error &e)
+  {
+    SPDLOG_ERROR("{:t}", e);
+  }
+}
+
 auto Node::save(OStrm &strm) const -> void
 {
-  ::ser(strm, *this);
+  auto props = Props{};
+  props.loc = loc();
+  props.scale = scale();
+  props.pivot_ = pivot();
+  props.rot = rot();
+  props.uniformScaling = uniformScaling;
+  props.zOrder = zOrder();
+  ::ser(strm, props);
 }
 
 auto Node::load(IStrm &strm) -> void
 {
-  ::deser(strm, *this);
+  auto props = Props{};
+  ::deser(strm, props);
+  loc() = props.loc;
+  scale() = props.scale;
+  pivot() = props.pivot_;
+  rot() = props.rot;
+  uniformScaling = props.uniformScaling;
+  zOrder() = props.zOrder;
 }
 
 auto Node::isTransparent(glm::vec2) const -> bool
@@ -893,6 +1032,76 @@ auto Node::isTransparent(glm::vec2) const -> bool
   return false;
 }
 
+auto Node::preload() const -> void {}
+
+auto Node::tick(float /*dt*/) -> void {}
+
+auto Node::textureRefs(std::vector<const std::shared_ptr<const Texture> *> &) const -> void {}
+
+auto Node::subtreeTextureBytes() const -> size_t
+{
+  auto refs = std::vector<const std::shared_ptr<const Texture> *>{};
+  auto collect = [&refs](const Node &n, auto &self) -> void {
+    n.textureRefs(refs);
+    for (const auto &c : n.nodes)
+      self(*c, self);
+  };
+  collect(*this, collect);
+  auto counts = std::map<const Texture *, long>{};
+  for (const auto *r : refs)
+    ++counts[r->get()];
+  auto ret = size_t{0};
+  for (const auto *r : refs)
+  {
+    auto it = counts.find(r->get());
+    if (it == std::end(counts))
+      continue;
+    // Lib holds one more reference, anything beyond that keeps the texture alive without the subtree
+    if (r->use_count() <= it->second + 1)
+      ret += (*r)->bytes();
+    counts.erase(it);
+  }
+  return ret;
+}
+
+auto Node::actsWhileHidden() const -> bool
+{
+  return false;
+}
+
+auto Node::isSubtreeHidden() const -> bool
+{
+  // deferred chunks come from a subtree that was hidden as a whole, they need no check
+  return !visible() && !actsWhileHidden() &&
+         std::all_of(std::begin(nodes), std::end(nodes), [](const auto &n) { return n->isSubtreeHidden(); });
+}
+
+auto Node::tickAll(float dt, Jobs &jobs) -> void
+{
+  // tick() only touches its own node, so the tree is split by nodes rather than by subtrees, a
+  // typical scene has a single top level node
+  auto all = std::vector<Node *>{};
+  all.reserve(256);
+  flatten(all);
+  constexpr auto MinChunk = size_t{16};
+  const auto chunks = std::max(size_t{1}, std::min((size_t{jobs.size()} + 1) * 4, all.size() / MinChunk));
+  const auto chunkSize = (all.size() + chunks - 1) / chunks;
+  auto tasks = std::vector<Jobs::Task>{};
+  for (auto first = size_t{0}; first < all.size(); first += chunkSize)
+    tasks.emplace_back([&all, first, last = std::min(first + chunkSize, all.size()), dt]() {
+      for (auto i = first; i < last; ++i)
+        all[i]->tick(dt);
+    });
+  jobs.run(tasks);
+}
+
+auto Node::flatten(std::vector<Node *> &v) -> void
+{
+  v.push_back(this);
+  for (auto &n : nodes)
+    n->flatten(v);
+}
+
 auto Node::h() const -> float
 {
   return 1.f;
@@ -953,10 +1162,10 @@ auto Node::commit() -> void
   {
   case EditMode::translate:
     undo.get().record(
-      [newLoc = loc, alive = weak_self()]() {
+      [newLoc = loc(), alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->loc = newLoc;
+          self->loc() = newLoc;
         }
         else
         {
@@ -966,7 +1175,7 @@ auto Node::commit() -> void
       [oldLoc = initLoc, alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->loc = oldLoc;
+          self->loc() = oldLoc;
         }
         else
         {
@@ -976,10 +1185,10 @@ auto Node::commit() -> void
     break;
   case EditMode::rotate:
     undo.get().record(
-      [newRot = rot, alive = weak_self()]() {
+      [newRot = rot(), alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->rot = newRot;
+          self->rot() = newRot;
         }
         else
         {
@@ -989,7 +1198,7 @@ auto Node::commit() -> void
       [oldRot = initRot, alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->rot = oldRot;
+          self->rot() = oldRot;
         }
         else
         {
@@ -999,10 +1208,10 @@ auto Node::commit() -> void
     break;
   case EditMode::scale:
     undo.get().record(
-      [newScale = scale, alive = weak_self()]() {
+      [newScale = scale(), alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->scale = newScale;
+          self->scale() = newScale;
         }
         else
         {
@@ -1012,7 +1221,7 @@ auto Node::commit() -> void
       [oldScale = initScale, alive = weak_self()]() {
         if (auto self = alive.lock())
         {
-          self->scale = oldScale;
+          self->scale() = oldScale;
         }
         else
         {
@@ -1033,7 +1242,12 @@ auto Node::editMode() const -> EditMode
 
 auto Node::pivot() const -> glm::vec2
 {
-  return pivot_;
+  return transformSlot.get<&Transforms::Page::pivot>();
+}
+
+auto Node::pivot() -> glm::vec2 &
+{
+  return transformSlot.get<&Transforms::Page::pivot>();
 }
 
 auto Node::parentWith(Node &newParent) -> void
@@ -1052,9 +1266,9 @@ auto Node::parentWith(Node &newParent) -> void
     [&newParent, alive = weak_self(), it, other]() {
       if (auto self = alive.lock())
       {
-        glm::mat4 newParentTransform = newParent.modelViewMat;
-        self->modelViewMat = glm::inverse(newParentTransform) * self->modelViewMat;
-        self->loc = glm::vec2{self->modelViewMat[3][0], self->modelViewMat[3][1]};
+        glm::mat4 newParentTransform = newParent.modelViewMat();
+        self->modelViewMat() = glm::inverse(newParentTransform) * self->modelViewMat();
+        self->loc() = glm::vec2{self->modelViewMat()[3][0], self->modelViewMat()[3][1]};
 
         newParent.nodes.emplace_back(std::move(other));
         self->parent_->nodes.erase(it);
@@ -1065,10 +1279,10 @@ auto Node::parentWith(Node &newParent) -> void
         SPDLOG_INFO("this was destroyed");
       }
     },
-    [it, &newParent, oldLoc = loc, oldParent, alive = weak_self(), other]() {
+    [it, &newParent, oldLoc = loc(), oldParent, alive = weak_self(), other]() {
       if (auto self = alive.lock())
       {
-        self->loc = oldLoc;
+        self->loc() = oldLoc;
         auto it2 = std::find(std::begin(newParent.nodes), std::end(newParent.nodes), self);
         assert(it2 != std::end(newParent.nodes));
         newParent.nodes.erase(it2);
@@ -1,5 +1,6 @@
 #pragma once
 #include "lib.hpp"
+#include "prj-file.hpp"
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/vec2.hpp>
 #include <imgui.h>
@@ -24,16 +25,6 @@ namespace Internal
 class Node : public virtual enable_shared_from_this
 {
 public:
-#define SER_PROP_LIST       \
-  SER_PROP(loc);            \
-  SER_PROP(scale);          \
-  SER_PROP(pivot_);         \
-  SER_PROP(rot);            \
-  SER_PROP(uniformScaling); \
-  SER_PROP(zOrder);
-  SER_DEF_PROPS()
-#undef SER_PROP_LIST
-
   using PNodes = std::vector<std::shared_ptr<Node>>;
   using Nodes = std::vector<std::reference_wrapper<Node>>;
   enum class EditMode {
@@ -50,7 +41,16 @@ public:
   auto editMode() const -> EditMode;
   auto getName() const -> std::string;
   auto getNodes() const -> const PNodes &;
+  // the flat format of projects saved before the chunked one
   auto loadAll(const class SaveFactory &, IStrm &) -> void;
+  // loads the chunks under into, or returns the top level node when into is null; children of
+  // hidden nodes stay serialized until the node is shown or expanded in the outliner
+  static auto loadAll(const class SaveFactory &, const Prj::Reader &, Node *into) -> std::unique_ptr<Node>;
+  auto hasLazyChildren() const -> bool { return lazy != nullptr; }
+  // saveAll reuses the serialized node until it is marked dirty
+  auto markDirty() -> void { savedChunk = nullptr; }
+  auto markDirtyAll() -> void;
+  auto loadLazy() -> void;
   auto localToScreen(const glm::mat4 &projMat, glm::vec2 local) const -> glm::vec2;
   auto moveDown() -> void;
   auto moveUp() -> void;
@@ -59,11 +59,14 @@ public:
   auto parentWith(Node &) -> void;
   auto parentWithBellow() -> void;
   auto pivot() const -> glm::vec2;
+  auto pivot() -> glm::vec2 &;
   auto placeBellow(Node &) -> void;
   auto renderAll(float dt, Node *hovered, Node *selected) -> void;
   auto rotStart(glm::vec2 mouse) -> void;
-  auto saveAll(OStrm &) const -> void;
+  auto saveAll(Prj::Writer &, int32_t parent = -1) const -> void;
   auto scaleStart(glm::vec2 mouse) -> void;
+  // advances the state of the whole tree, the nodes are ticked in parallel chunks
+  auto tickAll(float dt, class Jobs &) -> void;
   auto translateStart(glm::vec2 mouse) -> void;
   auto unparent() -> void;
   auto update(const glm::mat4 &projMat, glm::vec2 mouse) -> void;
@@ -72,65 +75,113 @@ public:
   static auto delNoUndo(Node &) -> void;
   virtual auto h() const -> float;
   virtual auto isTransparent(glm::vec2) const -> bool;
+  // called instead of render while the node is hidden and selected, so showing it does not wait for the disk
+  virtual auto preload() const -> void;
   virtual auto renderUi() -> void;
+  // one entry per reference the node holds, for the undo history that pins deleted nodes
+  virtual auto textureRefs(std::vector<const std::shared_ptr<const Texture> *> &) const -> void;
+  // memory only the subtree keeps alive, textures also used elsewhere are not counted
+  auto subtreeTextureBytes() const -> size_t;
   virtual auto w() const -> float;
   virtual ~Node();
 
-  bool visible = true;
+  auto visible() -> bool & { return transformSlot.get<&Transforms::Page::visible>(); }
+  auto visible() const -> bool { return transformSlot.get<&Transforms::Page::visible>(); }
 
 protected:
+  auto loc() -> glm::vec2 & { return transformSlot.get<&Transforms::Page::loc>(); }
+  auto loc() const -> glm::vec2 { return transformSlot.get<&Transforms::Page::loc>(); }
+  auto scale() -> glm::vec2 & { return transformSlot.get<&Transforms::Page::scale>(); }
+  auto scale() const -> glm::vec2 { return transformSlot.get<&Transforms::Page::scale>(); }
+  auto rot() -> float & { return transformSlot.get<&Transforms::Page::rot>(); }
+  auto rot() const -> float { return transformSlot.get<&Transforms::Page::rot>(); }
+  auto dLoc() -> glm::vec2 & { return transformSlot.get<&Transforms::Page::dLoc>(); }
+  auto dRot() -> float & { return transformSlot.get<&Transforms::Page::dRot>(); }
+  auto dScale() -> glm::vec2 & { return transformSlot.get<&Transforms::Page::dScale>(); }
+  auto zOrder() -> int & { return transformSlot.get<&Transforms::Page::zOrder>(); }
+  auto zOrder() const -> int { return transformSlot.get<&Transforms::Page::zOrder>(); }
+  auto modelViewMat() -> glm::mat4 & { return transformSlot.get<&Transforms::Page::world>(); }
+  auto modelViewMat() const -> const glm::mat4 & { return transformSlot.get<&Transforms::Page::world>(); }
+  auto transformId() const -> Transforms::Handle { return transformSlot.id(); }
+  // false when the node was entirely outside of the screen last frame
+  auto isOnScreen() const -> bool { return transformSlot.get<&Transforms::Page::onScreen>(); }
   auto screenToLocal(const glm::mat4 &projMat, glm::vec2) const -> glm::vec2;
+  // nodes that do something besides drawing, e.g. read the chat aloud, are loaded even when hidden
+  // together with their ancestors
+  virtual auto actsWhileHidden() const -> bool;
   virtual auto load(IStrm &) -> void;
   virtual auto render(float dt, Node *hovered, Node *selected) -> void;
   virtual auto save(OStrm &) const -> void;
+  // per-frame logic, may run on a worker thread: touch only the node's own state and no GL or textures
+  virtual auto tick(float dt) -> void;
 
   std::string name;
 
 private:
   virtual auto do_clone() const -> std::shared_ptr<Node>;
+  auto isSubtreeHidden() const -> bool;
   auto collectUnderNodes(const glm::mat4 &projMat, glm::vec2 v, Nodes &) -> void;
-  auto getAllNodesCalcModelView(Nodes &) -> void;
+  auto collectAll(Nodes &, int parentIdx) -> void;
   auto rotCancel() -> void;
   auto rotUpdate(const glm::mat4 &projMat, glm::vec2 mouse) -> void;
   auto scaleCancel() -> void;
   auto scaleUpdate(const glm::mat4 &projMat, glm::vec2 mouse) -> void;
+  auto flatten(std::vector<Node *> &) -> void;
   auto translateCancel() -> void;
   auto translateUpdate(const glm::mat4 &projMat, glm::vec2 mouse) -> void;
 
 private:
-  glm::vec2 loc = {.0f, .0f};
-  glm::vec2 scale = {1.f, 1.f};
-  glm::vec2 pivot_ = {.0f, .0f};
-  float rot = 0.f;
+  // the saved properties, the values themselves live in Transforms
+  struct Props
+  {
+#define SER_PROP_LIST       \
+  SER_PROP(loc);            \
+  SER_PROP(scale);          \
+  SER_PROP(pivot_);         \
+  SER_PROP(rot);            \
+  SER_PROP(uniformScaling); \
+  SER_PROP(zOrder);
+    SER_DEF_PROPS()
+#undef SER_PROP_LIST
+
+    glm::vec2 loc = {.0f, .0f};
+    glm::vec2 scale = {1.f, 1.f};
+    glm::vec2 pivot_ = {.0f, .0f};
+    float rot = 0.f;
+    bool uniformScaling = true;
+    int zOrder = 0;
+  };
+
   bool uniformScaling = true;
 
-protected:
-  float dRot = 0.f;
-  glm::vec2 dLoc = {.0f, .0f};
-  glm::vec2 dScale = {0.f, 0.f};
-  std::reference_wrapper<class Undo> undo;
-  int zOrder = 0;
+  struct Lazy
+  {
+    std::string chunks;
+    const class SaveFactory *saveFactory;
+  };
 
-private:
-  PNodes nodes;
+  // serialized children not loaded yet
+  std::shared_ptr<const Lazy> lazy;
+
+  struct SavedChunk
+  {
+    std::string payload;
+    uint32_t crc;
+  };
+
+  mutable std::shared_ptr<const SavedChunk> savedChunk;
 
 protected:
-  glm::mat4 modelViewMat;
+  std::reference_wrapper<class Undo> undo;
+  std::reference_wrapper<const Icons> icons;
 
 private:
+  Transforms::Slot transformSlot;
+  PNodes nodes;
   Node *parent_ = nullptr;
   glm::vec2 startMousePos;
   glm::vec2 initLoc;
   glm::vec2 initScale;
   float initRot;
   EditMode editMode_ = EditMode::select;
-  std::shared_ptr<const Texture> arrowN;
-  std::shared_ptr<const Texture> arrowNE;
-  std::shared_ptr<const Texture> arrowE;
-  std::shared_ptr<const Texture> arrowSE;
-  std::shared_ptr<const Texture> arrowS;
-  std::shared_ptr<const Texture> arrowSW;
-  std::shared_ptr<const Texture> arrowW;
-  std::shared_ptr<const Texture> arrowNW;
-  std::shared_ptr<const Texture> center;
 };
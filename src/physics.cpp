@@ -0,0 +1,169 @@
+#include "physics.hpp"
+#include <algorithm>
+#include <cassert>
+#include <glm/glm.hpp>
+
+Physics::Body::Body(Physics &aOwner) : owner(&aOwner), id(aOwner.add()) {}
+
+Physics::Body::Body(const Body &other) : owner(other.owner), id(owner->add())
+{
+  const auto i = owner->indices[id];
+  const auto j = owner->indices[other.id];
+  owner->params[i] = owner->params[j];
+}
+
+Physics::Body::~Body()
+{
+  owner->remove(id);
+}
+
+auto Physics::Body::sync(Transforms::Handle node, const Params &v) -> void
+{
+  const auto i = owner->indices[id];
+  if (owner->nodes[i] != node)
+  {
+    owner->nodes[i] = node;
+    owner->fresh[i] = true;
+  }
+  owner->params[i] = v;
+}
+
+auto Physics::Body::reset() -> void
+{
+  const auto i = owner->indices[id];
+  owner->rotV[i] = 0.f;
+  owner->rot[i] = 0.f;
+  owner->prevRot[i] = 0.f;
+  owner->fresh[i] = true;
+}
+
+Physics::Physics(Transforms &aTransforms) : transforms(aTransforms) {}
+
+auto Physics::add() -> uint32_t
+{
+  auto id = static_cast<uint32_t>(indices.size());
+  if (!freeIds.empty())
+  {
+    id = freeIds.back();
+    freeIds.pop_back();
+  }
+  else
+    indices.push_back(0);
+  indices[id] = static_cast<uint32_t>(ids.size());
+  ids.push_back(id);
+  // not bound to a node until the first sync
+  nodes.push_back(UINT32_MAX);
+  params.emplace_back();
+  fresh.push_back(true);
+  active.push_back(false);
+  prevSample.emplace_back();
+  sample.emplace_back();
+  normal.emplace_back();
+  lastPivot.emplace_back();
+  lastPivotV.emplace_back();
+  rotV.push_back(0.f);
+  rot.push_back(0.f);
+  prevRot.push_back(0.f);
+  return id;
+}
+
+auto Physics::remove(uint32_t id) -> void
+{
+  const auto i = indices[id];
+  const auto last = ids.size() - 1;
+  if (i != last)
+  {
+    ids[i] = ids[last];
+    indices[ids[i]] = i;
+    nodes[i] = nodes[last];
+    params[i] = params[last];
+    fresh[i] = fresh[last];
+    active[i] = active[last];
+    prevSample[i] = prevSample[last];
+    sample[i] = sample[last];
+    normal[i] = normal[last];
+    lastPivot[i] = lastPivot[last];
+    lastPivotV[i] = lastPivotV[last];
+    rotV[i] = rotV[last];
+    rot[i] = rot[last];
+    prevRot[i] = prevRot[last];
+  }
+  ids.pop_back();
+  nodes.pop_back();
+  params.pop_back();
+  fresh.pop_back();
+  active.pop_back();
+  prevSample.pop_back();
+  sample.pop_back();
+  normal.pop_back();
+  lastPivot.pop_back();
+  lastPivotV.pop_back();
+  rotV.pop_back();
+  rot.pop_back();
+  prevRot.pop_back();
+  freeIds.push_back(id);
+}
+
+auto Physics::step(float dt, const glm::mat4 &projMat) -> void
+{
+  auto &tr = transforms.get();
+  const auto n = ids.size();
+
+  // sample the projected pivot once per frame, the steps in between interpolate it
+  for (auto i = 0U; i < n; ++i)
+  {
+    if (nodes[i] == UINT32_MAX)
+    {
+      active[i] = false;
+      continue;
+    }
+    const auto &world = tr.get<&Transforms::Page::world>(nodes[i]);
+    const auto pivot = tr.get<&Transforms::Page::pivot>(nodes[i]);
+    const auto &p = params[i];
+    const auto projPivot = glm::vec2{projMat * world * glm::vec4{pivot.x, pivot.y, 0.f, 1.f}};
+    prevSample[i] = fresh[i] ? projPivot : sample[i];
+    sample[i] = projPivot;
+    if (fresh[i])
+    {
+      lastPivot[i] = projPivot;
+      lastPivotV[i] = {0.f, 0.f};
+      fresh[i] = false;
+    }
+    active[i] = p.enabled && glm::length(p.end - pivot) >= 1.f;
+    if (!active[i])
+      continue;
+    const auto projEnd = glm::vec2{projMat * world * glm::vec4{p.end.x, p.end.y, 0.f, 1.f}};
+    const auto pivotToEnd = projEnd - projPivot;
+    normal[i] = glm::normalize(glm::vec2{-pivotToEnd.y, pivotToEnd.x});
+  }
+
+  // a long frame is not worth simulating in full, it would only make the springs explode
+  const auto frameDt = std::min(std::max(dt, 0.f), .25f);
+  accumulator += frameDt;
+  const auto gForce = glm::vec2{0.f, .3f};
+  while (accumulator >= Dt)
+  {
+    accumulator -= Dt;
+    const auto t = frameDt > 0.f ? std::clamp(1.f - accumulator / frameDt, 0.f, 1.f) : 1.f;
+    for (auto i = 0U; i < n; ++i)
+    {
+      const auto pivot = prevSample[i] + (sample[i] - prevSample[i]) * t;
+      const auto v = (pivot - lastPivot[i]) / Dt;
+      const auto a = (v - lastPivotV[i]) / Dt + gForce;
+      lastPivot[i] = pivot;
+      lastPivotV[i] = v;
+      prevRot[i] = rot[i];
+      if (!active[i])
+        continue;
+      const auto &p = params[i];
+      const auto projection = glm::dot(a, normal[i]);
+      rotV[i] += (-p.force * projection - rot[i] * p.springiness - rotV[i] * p.damping) * Dt;
+      rot[i] += rotV[i] * Dt;
+    }
+  }
+
+  const auto alpha = accumulator / Dt;
+  for (auto i = 0U; i < n; ++i)
+    if (active[i])
+      tr.get<&Transforms::Page::dRot>(nodes[i]) = prevRot[i] + (rot[i] - prevRot[i]) * alpha;
+}
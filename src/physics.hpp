@@ -0,0 +1,70 @@
+#pragma once
+#include "transforms.hpp"
+#include <cstdint>
+#include <functional>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <vector>
+
+// Spring physics of the nodes, simulated at a fixed rate independent of the frame rate. The
+// rotation shown on screen is interpolated between the last two simulation steps.
+class Physics
+{
+public:
+  static constexpr auto Dt = 1.f / 120.f;
+
+  struct Params
+  {
+    bool enabled = false;
+    glm::vec2 end = {0.f, 0.f};
+    float force = 200.f;
+    float damping = 1.f;
+    float springiness = 2.f;
+  };
+
+  // owns a body, copying a body creates a new one with the same parameters
+  class Body
+  {
+  public:
+    Body(Physics &);
+    Body(const Body &);
+    auto operator=(const Body &) -> Body & = delete;
+    ~Body();
+
+    // the node and parameters to simulate with from the next frame on
+    auto sync(Transforms::Handle, const Params &) -> void;
+    auto reset() -> void;
+
+  private:
+    Physics *owner;
+    uint32_t id;
+  };
+
+  Physics(Transforms &);
+  // advances the simulation by the time of the frame, the world matrices are from the last frame
+  auto step(float dt, const glm::mat4 &projMat) -> void;
+
+private:
+  std::reference_wrapper<Transforms> transforms;
+  float accumulator = 0.f;
+
+  // bodies are kept dense, a body id maps to its index
+  std::vector<uint32_t> indices;
+  std::vector<uint32_t> freeIds;
+  std::vector<uint32_t> ids;
+  std::vector<Transforms::Handle> nodes;
+  std::vector<Params> params;
+  std::vector<bool> fresh;
+  std::vector<bool> active;
+  std::vector<glm::vec2> prevSample;
+  std::vector<glm::vec2> sample;
+  std::vector<glm::vec2> normal;
+  std::vector<glm::vec2> lastPivot;
+  std::vector<glm::vec2> lastPivotV;
+  std::vector<float> rotV;
+  std::vector<float> rot;
+  std::vector<float> prevRot;
+
+  auto add() -> uint32_t;
+  auto remove(uint32_t id) -> void;
+};
@@ -81,6 +81,18 @@ auto PreferencesDialog::internalDraw() -> DialogState
         preferences.get().openAiToken = buf;
       ImGui::PopItemWidth();
     }
+    {
+      ImGui::TableNextColumn();
+      Ui::textRj("Open AI URL:");
+      ImGui::TableNextColumn();
+      ImGui::PushItemWidth(ImGui::GetFontSize() * 40.f);
+      char buf[1024];
+      strcpy(buf, preferences.get().openAiUrl.data());
+      if (ImGui::InputText("##Open AI URL", buf, sizeof(buf)))
+        preferences.get().openAiUrl = buf;
+      ImGui::Text("e.g.: https://api.openai.com or a local server with the same API");
+      ImGui::PopItemWidth();
+    }
     {
       ImGui::TableNextColumn();
       ImGui::Text("Audio Settings");
@@ -150,6 +162,60 @@ auto PreferencesDialog::internalDraw() -> DialogState
       ImGui::TableNextColumn();
       ImGui::DragInt("0 = unbounded##fps", &preferences.get().fps, 1, 0, 240);
     }
+    {
+      ImGui::TableNextColumn();
+      Ui::textRj("Texture RAM:");
+      ImGui::TableNextColumn();
+      ImGui::DragInt("MiB##textureRamMb", &preferences.get().textureRamMb, 1, 64, 64 * 1024);
+    }
+    {
+      ImGui::TableNextColumn();
+      Ui::textRj("Texture VRAM:");
+      ImGui::TableNextColumn();
+      ImGui::DragInt("MiB##textureVramMb", &preferences.get().textureVramMb, 1, 64, 64 * 1024);
+    }
+    {
+      ImGui::TableNextColumn();
+      Ui::textRj("Texture Disk Cache:");
+      ImGui::TableNextColumn();
+      ImGui::DragInt("MiB##textureCacheMb", &preferences.get().textureCacheMb, 1, 64, 256 * 1024);
+    }
+
+    {
+      ImGui::TableNextColumn();
+      ImGui::Text("Chat Settings");
+      ImGui::TableNextColumn();
+    }
+    {
+      ImGui::TableNextColumn();
+      Ui::textRj("History:");
+      ImGui::TableNextColumn();
+      ImGui::DragInt("messages##chatHistorySize", &preferences.get().chatHistorySize, 1, 10, 10'000);
+    }
+    {
+      ImGui::TableNextColumn();
+      Ui::textRj("History Memory:");
+      ImGui::TableNextColumn();
+      ImGui::DragInt("KiB##chatHistoryKb", &preferences.get().chatHistoryKb, 1, 16, 64 * 1024);
+    }
+
+    {
+      ImGui::TableNextColumn();
+      ImGui::Text("Project Settings");
+      ImGui::TableNextColumn();
+    }
+    {
+      ImGui::TableNextColumn();
+      Ui::textRj("Autosave:");
+      ImGui::TableNextColumn();
+      ImGui::DragInt("seconds, 0 = off##autosaveSec", &preferences.get().autosaveSec, 1, 0, 60 * 60);
+    }
+    {
+      ImGui::TableNextColumn();
+      Ui::textRj("Undo History:");
+      ImGui::TableNextColumn();
+      ImGui::DragInt("MiB##undoHistoryMb", &preferences.get().undoHistoryMb, 1, 1, 4 * 1024);
+    }
   }
   ImGui::SetCursorPosX(ImGui::GetWindowWidth() - BtnSz - ImGui::GetStyle().WindowPadding.x);
   if (ImGui::Button("OK", ImVec2(BtnSz, 0)))
@@ -65,8 +65,16 @@ Preferences::Preferences()
     audioIn = config->get_qualified_as<std::string>("audio.in").value_or("Default");
     azureKey = config->get_qualified_as<std::string>("azure.key").value_or("");
     openAiToken = config->get_qualified_as<std::string>("open-ai.token").value_or("");
+    openAiUrl = config->get_qualified_as<std::string>("open-ai.url").value_or("https://api.openai.com");
     vsync = config->get_qualified_as<bool>("graphics.vsync").value_or(true);
     fps = config->get_qualified_as<int>("graphics.fps").value_or(0);
+    textureRamMb = config->get_qualified_as<int>("graphics.texture-ram-mb").value_or(1024);
+    textureVramMb = config->get_qualified_as<int>("graphics.texture-vram-mb").value_or(512);
+    textureCacheMb = config->get_qualified_as<int>("graphics.texture-cache-mb").value_or(2048);
+    chatHistorySize = config->get_qualified_as<int>("chat.history-size").value_or(500);
+    chatHistoryKb = config->get_qualified_as<int>("chat.history-kb").value_or(512);
+    autosaveSec = config->get_qualified_as<int>("project.autosave-sec").value_or(60);
+    undoHistoryMb = config->get_qualified_as<int>("project.undo-history-mb").value_or(64);
   }
   catch (const cpptoml::parse_exception &e)
   {
@@ -74,6 +82,11 @@ Preferences::Preferences()
   }
 }
 
+auto Preferences::dir() -> std::filesystem::path
+{
+  return getPreferencesPath();
+}
+
 auto Preferences::save() -> void
 {
   auto configFilePath = getPreferencesPath();
@@ -104,14 +117,30 @@ auto Preferences::save() -> void
     {
       auto openAiTable = cpptoml::make_table();
       openAiTable->insert("token", openAiToken);
+      openAiTable->insert("url", openAiUrl);
       config->insert("open-ai", openAiTable);
     }
     {
       auto graphicsTable = cpptoml::make_table();
       graphicsTable->insert("vsync", vsync);
       graphicsTable->insert("fps", fps);
+      graphicsTable->insert("texture-ram-mb", textureRamMb);
+      graphicsTable->insert("texture-vram-mb", textureVramMb);
+      graphicsTable->insert("texture-cache-mb", textureCacheMb);
       config->insert("graphics", graphicsTable);
     }
+    {
+      auto chatTable = cpptoml::make_table();
+      chatTable->insert("history-size", chatHistorySize);
+      chatTable->insert("history-kb", chatHistoryKb);
+      config->insert("chat", chatTable);
+    }
+    {
+      auto projectTable = cpptoml::make_table();
+      projectTable->insert("autosave-sec", autosaveSec);
+      projectTable->insert("undo-history-mb", undoHistoryMb);
+      config->insert("project", projectTable);
+    }
 
     auto configFile = std::ofstream{configFilePath};
     if (!configFile.is_open())
@@ -1,4 +1,5 @@
 #pragma once
+#include <filesystem>
 #include <string>
 
 class Preferences
@@ -6,6 +7,8 @@ class Preferences
 public:
   Preferences();
   auto save() -> void;
+  // per user directory the preferences and caches live in
+  static auto dir() -> std::filesystem::path;
 
   constexpr static const char *DefaultAudio = "Default";
 
@@ -15,6 +18,14 @@ public:
   std::string audioIn = DefaultAudio;
   std::string azureKey;
   std::string openAiToken;
+  std::string openAiUrl = "https://api.openai.com";
   bool vsync = true;
   int fps = 0;
+  int textureRamMb = 1024;
+  int textureVramMb = 512;
+  int textureCacheMb = 2048;
+  int chatHistorySize = 500;
+  int chatHistoryKb = 512;
+  int autosaveSec = 60;
+  int undoHistoryMb = 64;
 };
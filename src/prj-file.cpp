@@ -0,0 +1,174 @@
+#include "prj-file.hpp"
+#include "jobs.hpp"
+#include "version.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fmt/core.h>
+#include <stdexcept>
+
+namespace Prj
+{
+  namespace
+  {
+    constexpr auto Magic = std::string_view{"VTPRJ\r\n\x1a", 8};
+    // magic, format version, number of chunks
+    constexpr auto HeaderSize = Magic.size() + 4 + 4;
+    // type, version, parent, flags, offset, size, crc and 4 bytes of padding
+    constexpr auto EntrySize = size_t{40};
+
+    auto crcTable() -> const std::array<uint32_t, 256> &
+    {
+      static const auto table = []() {
+        auto ret = std::array<uint32_t, 256>{};
+        for (auto i = 0U; i < ret.size(); ++i)
+        {
+          auto c = i;
+          for (auto k = 0; k < 8; ++k)
+            c = (c & 1) ? 0xedb88320U ^ (c >> 1) : c >> 1;
+          ret[i] = c;
+        }
+        return ret;
+      }();
+      return table;
+    }
+
+    template <typename T>
+    auto put(std::string &out, T v) -> void
+    {
+      out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+    }
+
+    template <typename T>
+    auto get(const char *&p) -> T
+    {
+      auto v = T{};
+      std::memcpy(&v, p, sizeof(v));
+      p += sizeof(v);
+      return v;
+    }
+  } // namespace
+
+  auto crc32(std::string_view v) -> uint32_t
+  {
+    const auto &table = crcTable();
+    auto c = 0xffffffffU;
+    for (auto ch : v)
+      c = table[(c ^ static_cast<uint8_t>(ch)) & 0xff] ^ (c >> 8);
+    return c ^ 0xffffffffU;
+  }
+
+  auto isChunked(const char *b, const char *e) -> bool
+  {
+    return static_cast<size_t>(e - b) >= Magic.size() && std::string_view{b, Magic.size()} == Magic;
+  }
+
+  auto Writer::add(ChunkType type, uint32_t version, int32_t parent, uint32_t flags, std::string_view payload)
+    -> int32_t
+  {
+    return add(type, version, parent, flags, payload, crc32(payload));
+  }
+
+  auto Writer::add(ChunkType type,
+                   uint32_t version,
+                   int32_t parent,
+                   uint32_t flags,
+                   std::string_view payload,
+                   uint32_t crc) -> int32_t
+  {
+    toc.push_back(Chunk{.type = type,
+                        .version = version,
+                        .parent = parent,
+                        .flags = flags,
+                        .offset = payloads.size(),
+                        .size = payload.size(),
+                        .crc = crc});
+    payloads.append(payload);
+    return static_cast<int32_t>(toc.size()) - 1;
+  }
+
+  auto Writer::splice(const Reader &reader, int32_t parent) -> void
+  {
+    const auto base = static_cast<int32_t>(toc.size());
+    for (auto i = 0U; i < reader.size(); ++i)
+    {
+      const auto &c = reader.chunk(i);
+      add(c.type, c.version, c.parent < 0 ? parent : base + c.parent, c.flags, reader.payload(i), c.crc);
+    }
+  }
+
+  auto Writer::str() const -> std::string
+  {
+    auto ret = std::string{};
+    const auto payloadsStart = HeaderSize + toc.size() * EntrySize;
+    ret.reserve(payloadsStart + payloads.size());
+    ret.append(Magic);
+    put(ret, saveVersion());
+    put(ret, static_cast<uint32_t>(toc.size()));
+    for (const auto &c : toc)
+    {
+      put(ret, c.type);
+      put(ret, c.version);
+      put(ret, c.parent);
+      put(ret, c.flags);
+      put(ret, static_cast<uint64_t>(payloadsStart + c.offset));
+      put(ret, c.size);
+      put(ret, c.crc);
+      put(ret, uint32_t{0});
+    }
+    ret.append(payloads);
+    return ret;
+  }
+
+  Reader::Reader(const char *aB, const char *aE) : b(aB), e(aE)
+  {
+    const auto sz = static_cast<size_t>(e - b);
+    if (!isChunked(b, e) || sz < HeaderSize)
+      throw std::runtime_error("Not a chunked project file");
+    auto p = b + Magic.size();
+    const auto ver = get<uint32_t>(p);
+    const auto n = get<uint32_t>(p);
+    // the container layout itself only changes together with the magic, the versions that matter
+    // are the per chunk ones
+    if (ver < 3)
+      throw std::runtime_error(fmt::format("Unexpected container version {}", ver));
+    if (n > (sz - HeaderSize) / EntrySize)
+      throw std::runtime_error("The table of contents is truncated");
+    toc.reserve(n);
+    for (auto i = 0U; i < n; ++i)
+    {
+      auto c = Chunk{};
+      c.type = get<ChunkType>(p);
+      c.version = get<uint32_t>(p);
+      c.parent = get<int32_t>(p);
+      c.flags = get<uint32_t>(p);
+      c.offset = get<uint64_t>(p);
+      c.size = get<uint64_t>(p);
+      c.crc = get<uint32_t>(p);
+      get<uint32_t>(p);
+      if (c.offset > sz || c.size > sz - c.offset)
+        throw std::runtime_error(fmt::format("Chunk {} is out of the file bounds", i));
+      if (c.parent >= static_cast<int32_t>(i))
+        throw std::runtime_error(fmt::format("Chunk {} comes before its parent", i));
+      toc.push_back(c);
+    }
+    valid.resize(n, 1);
+  }
+
+  auto Reader::payload(size_t i) const -> std::string_view
+  {
+    return std::string_view{b + toc[i].offset, static_cast<size_t>(toc[i].size)};
+  }
+
+  auto Reader::verify(Jobs &jobs) -> void
+  {
+    const auto batches = std::min(size(), static_cast<size_t>(jobs.size()) + 1);
+    auto tasks = std::vector<Jobs::Task>{};
+    for (auto j = 0U; j < batches; ++j)
+      tasks.emplace_back([this, j, batches]() {
+        for (auto i = j; i < size(); i += batches)
+          valid[i] = crc32(payload(i)) == toc[i].crc;
+      });
+    jobs.run(tasks);
+  }
+} // namespace Prj
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Jobs;
+
+// Project file container: a header, a table of contents and the chunk payloads. Every chunk has its
+// own type and version, so a reader skips what it does not know instead of rejecting the file.
+namespace Prj
+{
+  enum class ChunkType : uint32_t {
+    node = 0x45444f4e, // "NODE"
+  };
+
+  enum ChunkFlags : uint32_t {
+    hidden = 1,
+    // the node and all its descendants are hidden and none of them acts while hidden, only then the
+    // children are deferred; 2 marked nodes acting while hidden in older files and is ignored
+    subtreeHidden = 4,
+  };
+
+  struct Chunk
+  {
+    ChunkType type;
+    uint32_t version;
+    int32_t parent; // index of the parent chunk, -1 for the top level
+    uint32_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t crc;
+  };
+
+  auto crc32(std::string_view) -> uint32_t;
+  auto isChunked(const char *b, const char *e) -> bool;
+
+  class Reader;
+
+  class Writer
+  {
+  public:
+    // parent is an index returned by add, chunks have to be added after their parent
+    auto add(ChunkType, uint32_t version, int32_t parent, uint32_t flags, std::string_view payload) -> int32_t;
+    auto add(ChunkType, uint32_t version, int32_t parent, uint32_t flags, std::string_view payload, uint32_t crc)
+      -> int32_t;
+    // copies the chunks of another container, its top level chunks go under parent
+    auto splice(const Reader &, int32_t parent) -> void;
+    auto str() const -> std::string;
+
+  private:
+    std::vector<Chunk> toc;
+    std::string payloads;
+  };
+
+  class Reader
+  {
+  public:
+    // the buffer has to outlive the reader, throws when the header or the table of contents is damaged
+    Reader(const char *b, const char *e);
+    auto size() const -> size_t { return toc.size(); }
+    auto chunk(size_t i) const -> const Chunk & { return toc[i]; }
+    auto payload(size_t) const -> std::string_view;
+    // checks the payload checksums, spreading the chunks over the jobs
+    auto verify(Jobs &) -> void;
+    // false when verify found a damaged payload
+    auto isValid(size_t i) const -> bool { return valid[i] != 0; }
+
+  private:
+    const char *b;
+    const char *e;
+    std::vector<Chunk> toc;
+    std::vector<uint8_t> valid;
+  };
+} // namespace Prj
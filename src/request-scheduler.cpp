@@ -0,0 +1,141 @@
+#include "request-scheduler.hpp"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+RequestScheduler::RequestScheduler(uv::Uv &uv, unsigned aWindow, float ratePerSec, unsigned aMaxAttempts)
+  : timer(uv.createTimer()),
+    window(std::max(aWindow, 1U)),
+    interval(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>{1.f / ratePerSec})),
+    maxAttempts(aMaxAttempts),
+    nextStart(Clock::now()),
+    self(std::make_shared<RequestScheduler *>(this))
+{
+}
+
+RequestScheduler::~RequestScheduler()
+{
+  timer.stop();
+}
+
+auto RequestScheduler::push(Request request, Deliver giveUp) -> void
+{
+  auto slot = Slot{};
+  slot.id = nextId++;
+  slot.request = std::move(request);
+  slot.giveUp = std::move(giveUp);
+  slots.push_back(std::move(slot));
+  pump();
+}
+
+auto RequestScheduler::find(uint64_t id) -> Slot *
+{
+  // ids grow along the deque
+  auto it = std::lower_bound(
+    std::begin(slots), std::end(slots), id, [](const Slot &s, uint64_t v) { return s.id < v; });
+  if (it == std::end(slots) || it->id != id)
+    return nullptr;
+  return &*it;
+}
+
+auto RequestScheduler::finish(uint64_t id, Outcome outcome, Deliver deliver) -> void
+{
+  auto slot = find(id);
+  if (!slot || slot->state != State::running)
+    return;
+  --running;
+  if (outcome == Outcome::done)
+  {
+    slot->state = State::done;
+    slot->deliver = std::move(deliver);
+    flush();
+  }
+  else if (slot->attempts >= maxAttempts)
+  {
+    SPDLOG_INFO("Giving up on a request after {} attempts", slot->attempts);
+    slot->state = State::done;
+    slot->deliver = std::move(slot->giveUp);
+    flush();
+  }
+  else
+  {
+    // 1s, 2s, 4s... up to half a minute
+    const auto backoff = std::chrono::seconds{1} * (1 << std::min(slot->attempts - 1, 5U));
+    slot->state = State::backoff;
+    slot->retryAt = Clock::now() + std::min<Clock::duration>(backoff, std::chrono::seconds{30});
+  }
+  pump();
+}
+
+auto RequestScheduler::flush() -> void
+{
+  while (!slots.empty() && slots.front().state == State::done)
+  {
+    auto deliver = std::move(slots.front().deliver);
+    slots.pop_front();
+    // delivering can push more requests
+    if (deliver)
+      deliver();
+  }
+}
+
+auto RequestScheduler::pump() -> void
+{
+  // requests can finish synchronously, which lands here again through finish()
+  if (pumping)
+  {
+    repump = true;
+    return;
+  }
+  pumping = true;
+  do
+    repump = false;
+  while (startNext() || repump);
+  pumping = false;
+}
+
+auto RequestScheduler::startNext() -> bool
+{
+  timer.stop();
+  const auto now = Clock::now();
+  auto wakeUp = Clock::time_point::max();
+  for (auto &slot : slots)
+  {
+    if (running >= window)
+      return false;
+    if (slot.state == State::backoff && slot.retryAt > now)
+    {
+      wakeUp = std::min(wakeUp, slot.retryAt);
+      continue;
+    }
+    if (slot.state != State::queued && slot.state != State::backoff)
+      continue;
+    if (now < nextStart)
+    {
+      wakeUp = std::min(wakeUp, nextStart);
+      break;
+    }
+    nextStart = now + interval;
+    slot.state = State::running;
+    ++slot.attempts;
+    ++running;
+    // a synchronous finish can pop the slot, the request must not be destroyed while it runs
+    const auto id = slot.id;
+    auto request = std::move(slot.request);
+    request([alive = std::weak_ptr<RequestScheduler *>{self}, id](Outcome outcome, Deliver deliver) {
+      if (auto s = alive.lock())
+        (*s)->finish(id, outcome, std::move(deliver));
+      else
+        SPDLOG_INFO("this was destroyed");
+    });
+    // the deque may have changed, put it back for the retries
+    if (auto s = find(id))
+      s->request = std::move(request);
+    return true;
+  }
+  if (wakeUp != Clock::time_point::max())
+  {
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(wakeUp - now).count();
+    timer.start([this]() { pump(); }, static_cast<uint64_t>(std::max<decltype(ms)>(ms, 1)));
+  }
+  return false;
+}
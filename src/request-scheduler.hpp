@@ -0,0 +1,65 @@
+#pragma once
+#include "uv.hpp"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+
+// Keeps up to window requests of one service in flight and starts at most ratePerSec of them per
+// second. Results are delivered in the order the requests were pushed, so audio plays in order
+// while the requests overlap. A failed request is retried with exponential backoff and does not
+// hold back the ones behind it, only their delivery.
+class RequestScheduler
+{
+public:
+  enum class Outcome { done, retry };
+  using Deliver = std::move_only_function<void()>;
+  using Finish = std::move_only_function<void(Outcome, Deliver)>;
+  // called for every attempt, must call Finish exactly once
+  using Request = std::move_only_function<void(Finish)>;
+
+  RequestScheduler(uv::Uv &, unsigned window, float ratePerSec, unsigned maxAttempts = 6);
+  RequestScheduler(const RequestScheduler &) = delete;
+  ~RequestScheduler();
+
+  // giveUp is delivered in place of a result when the retries run out, so the caller hears back
+  auto push(Request, Deliver giveUp = nullptr) -> void;
+  auto inFlight() const -> unsigned { return running; }
+  auto queued() const -> size_t { return slots.size(); }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  enum class State { queued, running, backoff, done };
+
+  struct Slot
+  {
+    uint64_t id = 0;
+    Request request;
+    State state = State::queued;
+    unsigned attempts = 0;
+    Clock::time_point retryAt;
+    Deliver deliver;
+    Deliver giveUp;
+  };
+
+  uv::Timer timer;
+  unsigned window;
+  Clock::duration interval;
+  unsigned maxAttempts;
+  std::deque<Slot> slots;
+  uint64_t nextId = 0;
+  unsigned running = 0;
+  Clock::time_point nextStart;
+  // finish callbacks can outlive the scheduler, they check this first
+  std::shared_ptr<RequestScheduler *> self;
+  bool pumping = false;
+  bool repump = false;
+
+  auto find(uint64_t id) -> Slot *;
+  auto finish(uint64_t id, Outcome, Deliver) -> void;
+  auto flush() -> void;
+  auto pump() -> void;
+  auto startNext() -> bool;
+};
@@ -0,0 +1,87 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Fixed capacity FIFO, pushing into a full ring drops the oldest element. Index 0 is the oldest.
+template <typename T>
+class Ring
+{
+public:
+  Ring(size_t capacity = 0) : buf(capacity) {}
+
+  auto capacity() const -> size_t { return buf.size(); }
+  auto size() const -> size_t { return size_; }
+  auto empty() const -> bool { return size_ == 0; }
+
+  auto operator[](size_t i) -> T &
+  {
+    assert(i < size_);
+    return buf[(head + i) % buf.size()];
+  }
+
+  auto operator[](size_t i) const -> const T &
+  {
+    assert(i < size_);
+    return buf[(head + i) % buf.size()];
+  }
+
+  // both require a non empty ring, which also rules out capacity 0
+  auto front() -> T &
+  {
+    assert(!empty());
+    return buf[head];
+  }
+  auto back() -> T &
+  {
+    assert(!empty());
+    return buf[(head + size_ - 1) % buf.size()];
+  }
+
+  auto push_back(T v) -> void
+  {
+    if (buf.empty())
+      return;
+    if (size_ == buf.size())
+      pop_front();
+    buf[(head + size_) % buf.size()] = std::move(v);
+    ++size_;
+  }
+
+  auto pop_front() -> void
+  {
+    if (empty())
+      return;
+    // release whatever the element holds right away instead of on overwrite
+    buf[head] = T{};
+    head = (head + 1) % buf.size();
+    --size_;
+  }
+
+  // keeps the newest elements that fit
+  auto setCapacity(size_t v) -> void
+  {
+    if (v == buf.size())
+      return;
+    auto tmp = std::vector<T>(v);
+    const auto n = std::min(size_, v);
+    for (auto i = 0U; i < n; ++i)
+      tmp[i] = std::move((*this)[size_ - n + i]);
+    buf = std::move(tmp);
+    head = 0;
+    size_ = n;
+  }
+
+  auto clear() -> void
+  {
+    while (!empty())
+      pop_front();
+  }
+
+private:
+  std::vector<T> buf;
+  size_t head = 0;
+  size_t size_ = 0;
+};
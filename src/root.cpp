@@ -17,7 +17,7 @@ auto Root::do_clone() const -> std::shared_ptr<Node>
 
 auto Root::render(float dt, Node *hovered, Node *selected) -> void
 {
-  zOrder = INT_MIN;
+  zOrder() = INT_MIN;
   glClearColor(clearColor.x, clearColor.y, clearColor.z, clearColor.w);
   glClear(GL_COLOR_BUFFER_BIT);
   Node::render(dt, hovered, selected);
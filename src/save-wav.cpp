@@ -1,45 +1,56 @@
 #include "save-wav.hpp"
+#include <bit>
+#include <cstring>
 #include <ostream>
 
 namespace little_endian_io
 {
   template <typename Word>
-  std::ostream &writeWord(std::ostream &outs, Word value, unsigned size = sizeof(Word))
+  auto writeWord(std::string &out, Word value, unsigned size = sizeof(Word)) -> void
   {
     for (; size; --size, value >>= 8)
-      outs.put(static_cast<char>(value & 0xFF));
-    return outs;
+      out.push_back(static_cast<char>(value & 0xFF));
   }
 } // namespace little_endian_io
 using namespace little_endian_io;
 
-auto saveWav(std::ostream &f, const Wav &pcm, int sampleRate) -> void
+auto wavHeader(int sampleRate, uint32_t dataSize) -> std::string
 {
-  // Write the file headers
-  f << "RIFF----WAVEfmt ";                    // (chunk size to be filled in later)
-  writeWord(f, 16, 4);                        // no extension data
-  writeWord(f, 1, 2);                         // PCM - integer samples
-  writeWord(f, 1, 2);                         // one channel (mono file)
-  writeWord(f, sampleRate, 4);                // samples per second (Hz)
-  writeWord(f, (sampleRate * 16 * 1) / 8, 4); // (Sample Rate * BitsPerSample * Channels) / 8
-  writeWord(f, 2, 2);                         // data block size (size of two integer samples, one for each channel, in bytes)
-  writeWord(f, 16, 2);                        // number of bits per sample (use a multiple of 8)
-
-  // Write the data chunk header
-  const auto dataChunkPos = static_cast<long>(f.tellp());
-  f << "data----"; // (chunk size to be filled in later)
-
-  for (auto a : pcm)
-    writeWord(f, a, 2);
-
-  // (We'll need the final file size to fix the chunk sizes above)
-  const auto fileLength = static_cast<long>(f.tellp());
+  std::string ret;
+  ret.reserve(44);
+  ret += "RIFF";
+  // RIFF chunk size is (file size - 8) bytes, it saturates for a stream
+  writeWord(ret, dataSize == WavStreamSize ? WavStreamSize : dataSize + 36, 4);
+  ret += "WAVEfmt ";
+  writeWord(ret, 16, 4);                        // no extension data
+  writeWord(ret, 1, 2);                         // PCM - integer samples
+  writeWord(ret, 1, 2);                         // one channel (mono file)
+  writeWord(ret, sampleRate, 4);                // samples per second (Hz)
+  writeWord(ret, (sampleRate * 16 * 1) / 8, 4); // (Sample Rate * BitsPerSample * Channels) / 8
+  writeWord(ret, 2, 2);                         // data block size (size of two integer samples, one for each channel, in bytes)
+  writeWord(ret, 16, 2);                        // number of bits per sample (use a multiple of 8)
+  ret += "data";
+  writeWord(ret, dataSize, 4);
+  return ret;
+}
 
-  // Fix the data chunk header to contain the data size
-  f.seekp(dataChunkPos + 4);
-  writeWord(f, fileLength - dataChunkPos + 8);
+auto appendPcm(std::string &out, const Wav &pcm) -> void
+{
+  const auto pos = out.size();
+  out.resize(pos + pcm.size() * sizeof(int16_t));
+  if constexpr (std::endian::native == std::endian::little)
+    std::memcpy(out.data() + pos, pcm.data(), pcm.size() * sizeof(int16_t));
+  else
+    for (auto i = size_t{0}; i < pcm.size(); ++i)
+    {
+      out[pos + 2 * i] = static_cast<char>(pcm[i] & 0xFF);
+      out[pos + 2 * i + 1] = static_cast<char>((pcm[i] >> 8) & 0xFF);
+    }
+}
 
-  // Fix the file header to contain the proper RIFF chunk size, which is (file size - 8) bytes
-  f.seekp(0 + 4);
-  writeWord(f, fileLength - 8, 4);
+auto saveWav(std::ostream &f, const Wav &pcm, int sampleRate) -> void
+{
+  auto data = wavHeader(sampleRate, static_cast<uint32_t>(pcm.size() * sizeof(int16_t)));
+  appendPcm(data, pcm);
+  f.write(data.data(), static_cast<std::streamsize>(data.size()));
 }
@@ -1,7 +1,13 @@
 #pragma once
 #include "wav.hpp"
+#include <cstdint>
 #include <iosfwd>
 #include <string>
 #include <vector>
 
+// size of the data chunk when it is not known up front, e.g. while the audio is still recorded
+constexpr auto WavStreamSize = uint32_t{0xffffffff};
+
+auto wavHeader(int sampleRate, uint32_t dataSize) -> std::string;
+auto appendPcm(std::string &, const Wav &) -> void;
 auto saveWav(std::ostream &, const Wav &wav, int sampleRate) -> void;
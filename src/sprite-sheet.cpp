@@ -26,8 +26,11 @@ SpriteSheet::SpriteSheet(Lib &lib, Undo &aUndo, const std::filesystem::path &pat
 
 auto SpriteSheet::render() -> void
 {
+  const auto tex = texture->texture();
+  if (!texture->isReady())
+    return;
   glEnable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, texture->texture());
+  glBindTexture(GL_TEXTURE_2D, tex);
   glBegin(GL_QUADS);
   const auto fCols = static_cast<float>(cols);
   const auto fRows = static_cast<float>(rows);
@@ -118,3 +121,19 @@ auto SpriteSheet::numFrames() const -> int
 {
   return numFrames_;
 }
+
+auto SpriteSheet::preload(int) const -> void
+{
+  texture->load();
+}
+
+auto SpriteSheet::prefetch(int) const -> void
+{
+  texture->prefetch();
+}
+
+auto SpriteSheet::textureRefs(std::vector<const std::shared_ptr<const Texture> *> &v) const -> void
+{
+  if (texture)
+    v.push_back(&texture);
+}
@@ -0,0 +1,223 @@
+#include "texture-cache.hpp"
+#include "preferences.hpp"
+#include "prj-file.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fmt/format.h>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+  constexpr auto Magic = std::string_view{"VTTEX\r\n\x1a", 8};
+  constexpr auto Version = uint32_t{2};
+
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t srcCrc;
+    uint64_t srcSize;
+    int64_t srcMtime;
+    int32_t w;
+    int32_t h;
+    uint32_t flip;
+    uint32_t srcPathSize; // the source path follows the pixels
+  };
+  static_assert(sizeof(Header) == 48);
+
+  auto budget = std::atomic<uint64_t>{2048ULL * 1024 * 1024};
+  // bytes of the entries, exact after a prune and growing with every store
+  auto total = std::atomic<uint64_t>{0};
+  std::mutex pruneMutex;
+
+  auto dir() -> const std::filesystem::path &
+  {
+    static const auto ret = []() {
+      auto r = Preferences::dir() / "texture-cache";
+      auto ec = std::error_code{};
+      std::filesystem::create_directories(r, ec);
+      return r;
+    }();
+    return ret;
+  }
+
+  auto absPath(const std::filesystem::path &src) -> std::string
+  {
+    const auto abs = std::filesystem::absolute(src).generic_u8string();
+    return std::string{reinterpret_cast<const char *>(abs.data()), abs.size()};
+  }
+
+  auto cacheFile(const std::string &abs, bool flip) -> std::filesystem::path
+  {
+    return dir() / fmt::format("{:08x}-{}-{}.rgba", Prj::crc32(abs), abs.size(), flip ? "f" : "n");
+  }
+
+  // false when the entry is damaged, from another version or its source is gone or changed
+  auto isCurrent(const std::filesystem::path &file, uint64_t size) -> bool
+  {
+    auto fp = open_file(file, "rb");
+    if (!fp)
+      return false;
+    auto h = Header{};
+    if (std::fread(&h, sizeof(h), 1, fp.get()) != 1)
+      return false;
+    if (std::string_view{h.magic, sizeof(h.magic)} != Magic || h.version != Version || h.w <= 0 || h.h <= 0 ||
+        size != sizeof(Header) + static_cast<uint64_t>(h.w) * static_cast<uint64_t>(h.h) * 4 + h.srcPathSize)
+      return false;
+    auto src = std::string(h.srcPathSize, '\0');
+    if (std::fseek(fp.get(), static_cast<long>(size - h.srcPathSize), SEEK_SET) != 0 ||
+        std::fread(src.data(), 1, src.size(), fp.get()) != src.size())
+      return false;
+    const auto srcPath = std::filesystem::path{std::u8string{src.begin(), src.end()}};
+    auto ec = std::error_code{};
+    const auto srcSize = std::filesystem::file_size(srcPath, ec);
+    if (ec || srcSize != h.srcSize)
+      return false;
+    const auto mtime = std::filesystem::last_write_time(srcPath, ec);
+    return !ec && static_cast<int64_t>(mtime.time_since_epoch().count()) == h.srcMtime;
+  }
+} // namespace
+
+auto TextureCache::key(const std::filesystem::path &src, bool flip) -> std::optional<Key>
+{
+  auto ec = std::error_code{};
+  const auto mtime = std::filesystem::last_write_time(src, ec);
+  if (ec)
+    return std::nullopt;
+  auto file = MappedFile{src};
+  if (!file)
+    return std::nullopt;
+  auto ret = Key{};
+  ret.src = absPath(src);
+  ret.file = cacheFile(ret.src, flip);
+  ret.srcSize = file.size();
+  ret.srcMtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+  ret.srcCrc = Prj::crc32(std::string_view{file.data(), file.size()});
+  ret.flip = flip;
+  return ret;
+}
+
+auto TextureCache::load(const Key &key) -> std::optional<Entry>
+{
+  auto file = std::make_unique<MappedFile>(key.file);
+  if (!*file || file->size() < sizeof(Header))
+    return std::nullopt;
+  auto h = Header{};
+  std::memcpy(&h, file->data(), sizeof(h));
+  if (std::string_view{h.magic, sizeof(h.magic)} != Magic || h.version != Version ||
+      h.srcCrc != key.srcCrc || h.srcSize != key.srcSize || h.srcMtime != key.srcMtime ||
+      h.flip != (key.flip ? 1U : 0U) || h.w <= 0 || h.h <= 0 || h.srcPathSize != key.src.size() ||
+      file->size() != sizeof(Header) + static_cast<size_t>(h.w) * static_cast<size_t>(h.h) * 4 + h.srcPathSize)
+    return std::nullopt;
+  const auto sz = static_cast<size_t>(h.w) * static_cast<size_t>(h.h) * 4;
+  // two sources can share a file name, the path tells them apart
+  if (std::string_view{file->data() + sizeof(Header) + sz, h.srcPathSize} != key.src)
+    return std::nullopt;
+  // the mtime of the entry is its last use
+  auto ec = std::error_code{};
+  std::filesystem::last_write_time(key.file, std::filesystem::file_time_type::clock::now(), ec);
+  auto ret = Entry{};
+  ret.w = h.w;
+  ret.h = h.h;
+  ret.pixels = reinterpret_cast<const unsigned char *>(file->data() + sizeof(Header));
+  ret.mapping = std::move(file);
+  return ret;
+}
+
+auto TextureCache::store(const Key &key, int w, int h, const unsigned char *pixels) -> void
+{
+  auto header = Header{};
+  std::memcpy(header.magic, Magic.data(), Magic.size());
+  header.version = Version;
+  header.srcCrc = key.srcCrc;
+  header.srcSize = key.srcSize;
+  header.srcMtime = key.srcMtime;
+  header.w = w;
+  header.h = h;
+  header.flip = key.flip ? 1U : 0U;
+  header.srcPathSize = static_cast<uint32_t>(key.src.size());
+
+  const auto sz = static_cast<size_t>(w) * static_cast<size_t>(h) * 4;
+  auto data = std::string(sizeof(header) + sz, '\0');
+  std::memcpy(data.data(), &header, sizeof(header));
+  std::memcpy(data.data() + sizeof(header), pixels, sz);
+  data += key.src;
+  // the cache is only an optimization, a failed write costs one more decode next time
+  if (!replace_file(key.file, data))
+  {
+    SPDLOG_INFO("Failed to write texture cache {}", key.file.string());
+    return;
+  }
+  if ((total += data.size()) > budget)
+    prune();
+}
+
+auto TextureCache::invalidate(const std::filesystem::path &src) -> void
+{
+  const auto abs = absPath(src);
+  auto ec = std::error_code{};
+  std::filesystem::remove(cacheFile(abs, false), ec);
+  std::filesystem::remove(cacheFile(abs, true), ec);
+}
+
+auto TextureCache::setBudget(size_t v) -> void
+{
+  budget = v;
+}
+
+auto TextureCache::prune() -> void
+{
+  auto lock = std::lock_guard{pruneMutex};
+  struct Item
+  {
+    std::filesystem::file_time_type used;
+    uint64_t size;
+    std::filesystem::path file;
+  };
+  auto items = std::vector<Item>{};
+  auto sum = uint64_t{0};
+  const auto now = std::filesystem::file_time_type::clock::now();
+  auto ec = std::error_code{};
+  for (const auto &e : std::filesystem::directory_iterator{dir(), ec})
+  {
+    const auto &file = e.path();
+    auto fileEc = std::error_code{};
+    const auto used = e.last_write_time(fileEc);
+    if (fileEc)
+      continue;
+    if (file.extension() == ".tmp")
+    {
+      // left behind by a crash, a write in progress is much younger
+      if (now - used > std::chrono::hours{1})
+        std::filesystem::remove(file, fileEc);
+      continue;
+    }
+    if (file.extension() != ".rgba")
+      continue;
+    const auto size = e.file_size(fileEc);
+    if (fileEc)
+      continue;
+    if (!isCurrent(file, size))
+    {
+      std::filesystem::remove(file, fileEc);
+      continue;
+    }
+    items.push_back(Item{used, size, file});
+    sum += size;
+  }
+  std::sort(std::begin(items), std::end(items), [](const auto &a, const auto &b) { return a.used < b.used; });
+  // down to a bit under the budget, so the next stores do not rescan the directory right away
+  const auto target = budget - budget / 10;
+  for (auto i = 0U; i < items.size() && sum > target; ++i)
+  {
+    auto fileEc = std::error_code{};
+    if (std::filesystem::remove(items[i].file, fileEc))
+      sum -= items[i].size;
+  }
+  total = sum;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "file.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+
+// Decoded RGBA pixels kept on the disk next to the preferences, so a warm start maps them instead
+// of running the PNG decoder. An entry is valid while the size, mtime and CRC of the source match.
+// The mtime of an entry is its last use, over the disk budget the least recently used go first.
+namespace TextureCache
+{
+  struct Key
+  {
+    std::filesystem::path file;
+    std::string src; // absolute, kept in the entry so pruning can tell the source is gone
+    uint64_t srcSize = 0;
+    int64_t srcMtime = 0;
+    uint32_t srcCrc = 0;
+    bool flip = false;
+  };
+
+  struct Entry
+  {
+    int w = 0;
+    int h = 0;
+    std::unique_ptr<MappedFile> mapping;
+    const unsigned char *pixels = nullptr;
+  };
+
+  // nullopt when the source cannot be read
+  auto key(const std::filesystem::path &src, bool flip) -> std::optional<Key>;
+  auto load(const Key &) -> std::optional<Entry>;
+  auto store(const Key &, int w, int h, const unsigned char *pixels) -> void;
+  // drops the entries of the source, both flipped and not
+  auto invalidate(const std::filesystem::path &src) -> void;
+  auto setBudget(size_t) -> void;
+  // drops damaged entries, entries of missing or changed sources and the least recently used ones
+  // over the budget; scans the whole directory, so it runs on a worker
+  auto prune() -> void;
+} // namespace TextureCache
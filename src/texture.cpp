@@ -1,6 +1,12 @@
 #include "texture.hpp"
 #include "file.hpp"
+#include "jobs.hpp"
+#include "texture-cache.hpp"
+#include "trace.hpp"
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
 #include <fmt/std.h>
 #include <sdlpp/sdlpp.hpp>
 #include <spdlog/spdlog.h>
@@ -14,83 +20,170 @@
 #include <stb_image.h>
 #pragma GCC diagnostic pop
 
-Texture::Texture(uv::Uv &uv, std::string aPath, bool isUi)
-  : path_(std::move(aPath)),
-    imageData_([&]() {
-      stbi_set_flip_vertically_on_load(!isUi ? 1 : 0);
-      if (path_.find("engine:") != 0)
-      {
-        try
-        {
-          auto ret = stbi_load(path_.c_str(), &w_, &h_, &ch_, STBI_rgb_alpha);
-          if (!ret)
-            throw std::runtime_error(fmt::format("Error loading image from {:?}: {}", path_, stbi_failure_reason()));
+struct Texture::Image
+{
+  struct Deleter
+  {
+    auto operator()(unsigned char *v) const -> void { stbi_image_free(v); }
+  };
 
-          return ret;
-        }
-        catch (std::runtime_error &e)
-        {
-          SPDLOG_ERROR("{:t}", e);
-          auto engineImgPath = sdl::get_base_path() / "assets/corrupted.png";
-          auto fp = open_file(engineImgPath, "rb");
-          auto ret = stbi_load_from_file(fp.get(), &w_, &h_, &ch_, STBI_rgb_alpha);
-          if (!ret)
-            throw std::runtime_error(fmt::format("Error loading image from {:?}: {}", engineImgPath, stbi_failure_reason()));
-
-          return ret;
-        }
-      }
-      else
+  int w = 0;
+  int h = 0;
+  int ch = 4;
+  // points either into data or into the mapped cache entry
+  const unsigned char *pixels = nullptr;
+  std::unique_ptr<unsigned char, Deleter> data;
+  std::unique_ptr<MappedFile> mapping;
+
+  auto size() const -> size_t { return static_cast<size_t>(w) * static_cast<size_t>(h) * 4; }
+};
+
+namespace
+{
+  std::atomic<size_t> cpuBytes_ = 0;
+  std::atomic<size_t> gpuBytes_ = 0;
+
+  // stb_image keeps the flip flag in a global, the thread variant is safe to use from the decode
+  // workers
+  auto decodeFile(const std::filesystem::path &path, bool flip) -> Texture::Image
+  {
+    const auto key = TextureCache::key(path, flip);
+    if (key)
+      if (auto entry = TextureCache::load(*key))
       {
-        auto engineImgPath = sdl::get_base_path() / "assets" / path_.substr(7);
-        auto fp = open_file(engineImgPath, "rb");
-        auto ret = stbi_load_from_file(fp.get(), &w_, &h_, &ch_, STBI_rgb_alpha);
-        if (!ret)
-          throw std::runtime_error(fmt::format("Error loading image from {:?}: {}", engineImgPath, stbi_failure_reason()));
+        auto ret = Texture::Image{};
+        ret.w = entry->w;
+        ret.h = entry->h;
+        ret.pixels = entry->pixels;
+        ret.mapping = std::move(entry->mapping);
         return ret;
       }
-    }()),
-    texture_([&]() {
-      assert((ch_ == 4 || ch_ == 3) && "The number of channels should be 3 or 4.");
 
-      GLuint ret;
-      glGenTextures(1, &ret);
-      glBindTexture(GL_TEXTURE_2D, ret);
+    stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
+    auto fp = open_file(path, "rb");
+    if (!fp)
+      throw std::runtime_error(fmt::format("Error opening {:?}: {}", path, strerror(errno)));
+    auto ret = Texture::Image{};
+    ret.data.reset(stbi_load_from_file(fp.get(), &ret.w, &ret.h, &ret.ch, STBI_rgb_alpha));
+    if (!ret.data)
+      throw std::runtime_error(fmt::format("Error loading image from {:?}: {}", path, stbi_failure_reason()));
+    ret.pixels = ret.data.get();
+    if (key)
+      TextureCache::store(*key, ret.w, ret.h, ret.pixels);
+    return ret;
+  }
 
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  auto decode(const std::string &path, bool isUi) -> Texture::Image
+  {
+    TRACE_ZONE("Texture::decode");
+    if (path.find("engine:") == 0)
+      return decodeFile(sdl::get_base_path() / "assets" / path.substr(7), !isUi);
+    return decodeFile(path, !isUi);
+  }
 
-      if (ch_ == 4)
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w_, h_, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData_);
-      else
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w_, h_, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData_);
-      return ret;
-    }()),
-    event(std::make_unique<uv::FsEvent>(uv.createFsEvent()))
+  auto genTexture() -> GLuint
+  {
+    GLuint ret;
+    glGenTextures(1, &ret);
+    glBindTexture(GL_TEXTURE_2D, ret);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return ret;
+  }
+
+  auto texImage(int ch, int w, int h, const void *pixels) -> void
+  {
+    assert((ch == 4 || ch == 3) && "The number of channels should be 3 or 4.");
+    glTexImage2D(GL_TEXTURE_2D, 0, ch == 4 ? GL_RGBA : GL_RGB, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  }
+
+  // pixel buffer objects are not part of the GL 1.1 headers, resolve them once on the GL thread
+  struct Pbo
+  {
+    PFNGLGENBUFFERSPROC genBuffers = nullptr;
+    PFNGLDELETEBUFFERSPROC deleteBuffers = nullptr;
+    PFNGLBINDBUFFERPROC bindBuffer = nullptr;
+    PFNGLBUFFERDATAPROC bufferData = nullptr;
+    PFNGLMAPBUFFERPROC mapBuffer = nullptr;
+    PFNGLUNMAPBUFFERPROC unmapBuffer = nullptr;
+
+    auto isSupported() const -> bool
+    {
+      return genBuffers && deleteBuffers && bindBuffer && bufferData && mapBuffer && unmapBuffer;
+    }
+  };
+
+  auto pbo() -> const Pbo &
+  {
+    static const auto ret = []() {
+      auto r = Pbo{};
+      r.genBuffers = reinterpret_cast<PFNGLGENBUFFERSPROC>(SDL_GL_GetProcAddress("glGenBuffers"));
+      r.deleteBuffers = reinterpret_cast<PFNGLDELETEBUFFERSPROC>(SDL_GL_GetProcAddress("glDeleteBuffers"));
+      r.bindBuffer = reinterpret_cast<PFNGLBINDBUFFERPROC>(SDL_GL_GetProcAddress("glBindBuffer"));
+      r.bufferData = reinterpret_cast<PFNGLBUFFERDATAPROC>(SDL_GL_GetProcAddress("glBufferData"));
+      r.mapBuffer = reinterpret_cast<PFNGLMAPBUFFERPROC>(SDL_GL_GetProcAddress("glMapBuffer"));
+      r.unmapBuffer = reinterpret_cast<PFNGLUNMAPBUFFERPROC>(SDL_GL_GetProcAddress("glUnmapBuffer"));
+      if (!r.isSupported())
+        SPDLOG_INFO("Pixel buffer objects are not supported, textures are uploaded directly");
+      return r;
+    }();
+    return ret;
+  }
+
+  auto deletePbo(GLuint buf) -> void
+  {
+    pbo().bindBuffer(GL_PIXEL_UNPACK_BUFFER, buf);
+    pbo().unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    pbo().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    pbo().deleteBuffers(1, &buf);
+  }
+} // namespace
+
+Texture::Texture(uv::Uv &aUv, Jobs &aJobs, std::string aPath, bool aIsUi)
+  : uv(&aUv), jobs(&aJobs), path_(std::move(aPath)), isUi(aIsUi)
 {
-  event->start(
-    [this](std::string file, int /*events*/, int status) {
-      if (status != 0)
-        return;
-      path_ = std::move(file);
+  // UI icons are small and needed for layout right away, scene textures wait for the first render
+  if (isUi)
+  {
+    auto img = [&]() {
       try
       {
-        auto ret = stbi_load(path_.c_str(), &w_, &h_, &ch_, STBI_rgb_alpha);
-        if (!ret)
-          throw std::runtime_error(fmt::format("Error loading image from {:?}: {}", path_, stbi_failure_reason()));
-        imageData_ = ret;
-        glBindTexture(GL_TEXTURE_2D, texture_);
-        if (ch_ == 4)
-          glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w_, h_, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData_);
-        else
-          glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w_, h_, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData_);
+        return decode(path_, isUi);
       }
       catch (std::runtime_error &e)
       {
         SPDLOG_ERROR("{:t}", e);
+        return decode("engine:corrupted.png", isUi);
       }
+    }();
+    w_ = img.w;
+    h_ = img.h;
+    ch_ = img.ch;
+    cpuBytes_ += img.size();
+    image_ = std::make_unique<Image>(std::move(img));
+    imageData_ = image_->pixels;
+
+    texture_ = genTexture();
+    texImage(ch_, w_, h_, imageData_);
+    gpuBytes_ += img.size();
+    state = State::ready;
+  }
+
+  if (path_.find("engine:") == 0)
+    return;
+
+  event = std::make_unique<uv::FsEvent>(uv->createFsEvent());
+  debounce = std::make_unique<uv::Timer>(uv->createTimer());
+  event->start(
+    [this](std::string /*file*/, int /*events*/, int status) {
+      if (status != 0)
+        return;
+      TextureCache::invalidate(path_);
+      // editors tend to write the file several times per save
+      debounce->start([this]() { reload(); }, 200);
     },
     path_,
     0);
@@ -122,18 +215,218 @@ Texture::Texture(SDL_Surface *surface)
       return texture;
     }())
 {
+  state = State::ready;
+  gpuBytes_ += static_cast<size_t>(w_) * static_cast<size_t>(h_) * 4;
 }
 
 Texture::~Texture()
 {
   if (event)
     event->stop();
-  glDeleteTextures(1, &texture_);
-  if (imageData_)
-    stbi_image_free(imageData_);
+  if (debounce)
+    debounce->stop();
+  const auto sz = static_cast<size_t>(w_) * static_cast<size_t>(h_) * 4;
+  if (texture_ != 0)
+  {
+    glDeleteTextures(1, &texture_);
+    gpuBytes_ -= sz;
+  }
+  if (image_)
+    cpuBytes_ -= sz;
 }
 
 auto Texture::path() const -> std::string
 {
   return path_;
 }
+
+auto Texture::load() const -> void
+{
+  if (state != State::unloaded)
+    return;
+  state = State::loading;
+  auto img = std::make_shared<Image>();
+  jobs->submit(
+    [img, path = path_, isUi = isUi]() {
+      try
+      {
+        *img = decode(path, isUi);
+      }
+      catch (std::runtime_error &e)
+      {
+        SPDLOG_ERROR("{:t}", e);
+        try
+        {
+          *img = decode("engine:corrupted.png", isUi);
+        }
+        catch (std::runtime_error &e2)
+        {
+          SPDLOG_ERROR("{:t}", e2);
+        }
+      }
+    },
+    [alive = weak_self(), img]() {
+      if (auto self = alive.lock())
+        self->stage(img);
+      else
+        SPDLOG_INFO("this was destroyed");
+    });
+}
+
+auto Texture::prepare() const -> void
+{
+  switch (state)
+  {
+  case State::unloaded: load(); break;
+  case State::loading:
+  case State::ready:
+  case State::failed: break;
+  case State::evicted:
+    texture_ = genTexture();
+    texImage(ch_, w_, h_, imageData_);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    gpuBytes_ += static_cast<size_t>(w_) * static_cast<size_t>(h_) * 4;
+    state = State::ready;
+    break;
+  }
+}
+
+auto Texture::prefetch() const -> void
+{
+  lastUse_ = frame_;
+  prepare();
+}
+
+auto Texture::bytes() const -> size_t
+{
+  return (image_ ? image_->size() : 0) + (texture_ != 0 ? static_cast<size_t>(w_) * static_cast<size_t>(h_) * 4 : 0);
+}
+
+auto Texture::evict() const -> bool
+{
+  if (isUi || state != State::ready || !imageData_ || texture_ == 0)
+    return false;
+  glDeleteTextures(1, &texture_);
+  texture_ = 0;
+  gpuBytes_ -= static_cast<size_t>(w_) * static_cast<size_t>(h_) * 4;
+  state = State::evicted;
+  return true;
+}
+
+auto Texture::reload() const -> void
+{
+  // not loaded yet, the first use picks up the new file anyway
+  if (state != State::ready && state != State::evicted && state != State::failed)
+    return;
+  SPDLOG_INFO("Reloading {}", path_);
+  auto img = std::make_shared<Image>();
+  jobs->submit(
+    [img, path = path_, isUi = isUi]() {
+      try
+      {
+        *img = decode(path, isUi);
+      }
+      catch (std::runtime_error &e)
+      {
+        SPDLOG_ERROR("{:t}", e);
+      }
+    },
+    [alive = weak_self(), img]() {
+      if (auto self = alive.lock())
+        self->stage(img);
+      else
+        SPDLOG_INFO("this was destroyed");
+    });
+}
+
+auto Texture::stage(std::shared_ptr<Image> img) const -> void
+{
+  // on a failed decode keep showing the old image
+  if (!img->pixels)
+  {
+    if (state == State::loading)
+      state = State::failed;
+    return;
+  }
+
+  if (!pbo().isSupported())
+  {
+    swap(*img, 0);
+    return;
+  }
+
+  GLuint buf;
+  pbo().genBuffers(1, &buf);
+  pbo().bindBuffer(GL_PIXEL_UNPACK_BUFFER, buf);
+  pbo().bufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(img->size()), nullptr, GL_STREAM_DRAW);
+  auto dst = pbo().mapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+  pbo().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  if (!dst)
+  {
+    pbo().deleteBuffers(1, &buf);
+    swap(*img, 0);
+    return;
+  }
+
+  // the copy into the mapped buffer happens off the loop thread as well
+  jobs->submit(
+    [img, dst]() {
+      TRACE_ZONE("Texture::upload");
+      memcpy(dst, img->pixels, img->size());
+    },
+    [alive = weak_self(), img, buf]() {
+      if (auto self = alive.lock())
+        self->swap(*img, buf);
+      else
+      {
+        SPDLOG_INFO("this was destroyed");
+        deletePbo(buf);
+      }
+    });
+}
+
+auto Texture::swap(Image &img, GLuint buf) const -> void
+{
+  TRACE_ZONE("Texture::swap");
+  auto newTexture = genTexture();
+  if (buf != 0)
+  {
+    pbo().bindBuffer(GL_PIXEL_UNPACK_BUFFER, buf);
+    pbo().unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    texImage(img.ch, img.w, img.h, nullptr);
+    pbo().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    pbo().deleteBuffers(1, &buf);
+  }
+  else
+    texImage(img.ch, img.w, img.h, img.pixels);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  const auto oldSize = static_cast<size_t>(w_) * static_cast<size_t>(h_) * 4;
+  if (texture_ != 0)
+  {
+    glDeleteTextures(1, &texture_);
+    gpuBytes_ -= oldSize;
+  }
+  texture_ = newTexture;
+  gpuBytes_ += img.size();
+
+  if (image_)
+    cpuBytes_ -= oldSize;
+  w_ = img.w;
+  h_ = img.h;
+  ch_ = img.ch;
+  cpuBytes_ += img.size();
+  image_ = std::make_unique<Image>(std::move(img));
+  imageData_ = image_->pixels;
+  state = State::ready;
+}
+
+auto Texture::cpuBytes() -> size_t
+{
+  return cpuBytes_;
+}
+
+auto Texture::gpuBytes() -> size_t
+{
+  return gpuBytes_;
+}
@@ -1,14 +1,18 @@
 #pragma once
+#include "shared_from_this.hpp"
 #include "uv.hpp"
 #include <SDL.h>
 #include <SDL_opengl.h>
+#include <cstdint>
 #include <memory>
 #include <string>
 
-class Texture
+class Texture : public virtual enable_shared_from_this
 {
 public:
-  Texture(uv::Uv &, std::string path, bool isUi = false);
+  struct Image;
+
+  Texture(uv::Uv &, class Jobs &, std::string path, bool isUi = false);
   Texture(SDL_Surface *);
   ~Texture();
   Texture(const Texture &) = delete;
@@ -16,15 +20,55 @@ public:
   auto w() const -> int { return w_; }
   auto h() const -> int { return h_; }
   auto imageData() const -> const unsigned char * { return imageData_; }
-  auto texture() const -> GLuint { return texture_; }
+  // scene textures are decoded on first use, until then the size is 0 and the texture is not ready
+  auto texture() const -> GLuint
+  {
+    lastUse_ = frame_;
+    if (state != State::ready)
+      prepare();
+    return texture_;
+  }
+  auto isReady() const -> bool { return state == State::ready; }
+  auto load() const -> void;
+  // the texture is going to be shown soon, decode it or bring it back to the GPU ahead of time
+  auto prefetch() const -> void;
+  // drops the GL texture but keeps the decoded image, the next use uploads it again without
+  // touching the disk
+  auto evict() const -> bool;
+  auto lastUse() const -> uint64_t { return lastUse_; }
+  // decoded image and GL texture of this instance
+  auto bytes() const -> size_t;
   auto path() const -> std::string;
 
+  // bytes held by decoded images and by GL textures across all instances
+  static auto cpuBytes() -> size_t;
+  static auto gpuBytes() -> size_t;
+  static auto frame() -> uint64_t { return frame_; }
+  static auto nextFrame() -> void { ++frame_; }
+
 private:
+  // failed: neither the file nor the placeholder decoded, only a change of the file retries
+  enum class State { unloaded, loading, ready, evicted, failed };
+
+  static inline uint64_t frame_ = 1;
+
+  uv::Uv *uv = nullptr;
+  Jobs *jobs = nullptr;
   std::string path_;
-  int ch_ = 4;
-  int w_ = 0;
-  int h_ = 0;
-  unsigned char *imageData_ = nullptr;
-  GLuint texture_;
+  bool isUi = false;
+  mutable State state = State::unloaded;
+  mutable int ch_ = 4;
+  mutable int w_ = 0;
+  mutable int h_ = 0;
+  mutable std::unique_ptr<Image> image_;
+  mutable const unsigned char *imageData_ = nullptr;
+  mutable GLuint texture_ = 0;
+  mutable uint64_t lastUse_ = 0;
   std::unique_ptr<uv::FsEvent> event;
+  std::unique_ptr<uv::Timer> debounce;
+
+  auto prepare() const -> void;
+  auto reload() const -> void;
+  auto stage(std::shared_ptr<Image>) const -> void;
+  auto swap(Image &, GLuint pbo) const -> void;
 };
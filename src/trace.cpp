@@ -0,0 +1,161 @@
+#include "trace.hpp"
+#include "file.hpp"
+#include "ring.hpp"
+#include <chrono>
+#include <ctime>
+#include <fmt/format.h>
+#include <memory>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+  // per thread, at a few hundred zones a frame this covers the last minute or so
+  constexpr auto EventsPerThread = size_t{1} << 16;
+
+  const auto startTime = std::chrono::steady_clock::now();
+#ifdef VOICETUBER_TRACE
+  const auto startWallTime = std::chrono::system_clock::now();
+#endif
+
+  struct Event
+  {
+    const char *name = nullptr;
+    uint64_t start = 0;
+    uint64_t dur = 0;
+  };
+
+  struct Buffer
+  {
+    // only contended while dumping
+    std::mutex mutex;
+    Ring<Event> events{EventsPerThread};
+    std::string name;
+    int tid = 0;
+  };
+
+  struct Registry
+  {
+    std::mutex mutex;
+    // buffers of finished threads are kept, their zones still belong to the timeline
+    std::vector<std::shared_ptr<Buffer>> buffers;
+  };
+
+  auto registry() -> Registry &
+  {
+    static auto ret = Registry{};
+    return ret;
+  }
+
+  auto buffer() -> Buffer &
+  {
+    thread_local auto ret = []() {
+      auto b = std::make_shared<Buffer>();
+      auto &r = registry();
+      auto lock = std::unique_lock{r.mutex};
+      b->tid = static_cast<int>(r.buffers.size()) + 1;
+      r.buffers.push_back(b);
+      return b;
+    }();
+    return *ret;
+  }
+} // namespace
+
+auto Trace::now() -> uint64_t
+{
+  return static_cast<uint64_t>(
+    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime)
+      .count());
+}
+
+auto Trace::setThreadName(const char *v) -> void
+{
+#ifdef VOICETUBER_TRACE
+  auto &b = buffer();
+  auto lock = std::unique_lock{b.mutex};
+  b.name = v;
+#else
+  (void)v;
+#endif
+}
+
+Trace::Zone::~Zone()
+{
+  const auto end = now();
+  auto &b = buffer();
+  auto lock = std::unique_lock{b.mutex};
+  b.events.push_back(Event{name, start, end - start});
+}
+
+auto Trace::dump(const std::filesystem::path &path) -> bool
+{
+#ifndef VOICETUBER_TRACE
+  SPDLOG_ERROR("Tracing is disabled in this build, cannot write {}", path.string());
+  return false;
+#else
+  auto buffers = std::vector<std::shared_ptr<Buffer>>{};
+  {
+    auto &r = registry();
+    auto lock = std::unique_lock{r.mutex};
+    buffers = r.buffers;
+  }
+
+  auto out = std::string{"{\"traceEvents\":[\n"};
+  auto first = true;
+  auto sep = [&]() {
+    if (!first)
+      out += ",\n";
+    first = false;
+  };
+  auto events = std::vector<Event>{};
+  for (const auto &b : buffers)
+  {
+    auto name = std::string{};
+    {
+      auto lock = std::unique_lock{b->mutex};
+      events.clear();
+      for (auto i = 0U; i < b->events.size(); ++i)
+        events.push_back(b->events[i]);
+      name = b->name.empty() ? fmt::format("thread {}", b->tid) : b->name;
+    }
+    sep();
+    fmt::format_to(std::back_inserter(out),
+                   R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})",
+                   b->tid,
+                   name);
+    for (const auto &e : events)
+    {
+      sep();
+      fmt::format_to(std::back_inserter(out),
+                     R"({{"name":"{}","ph":"X","pid":1,"tid":{},"ts":{},"dur":{}}})",
+                     e.name,
+                     b->tid,
+                     e.start,
+                     e.dur);
+    }
+  }
+  // wall clock of ts 0, to match the timeline with the time of a recording
+  const auto t = std::chrono::system_clock::to_time_t(startWallTime);
+  auto tm = std::tm{};
+#ifdef _WIN32
+  localtime_s(&tm, &t);
+#else
+  localtime_r(&t, &tm);
+#endif
+  char startStr[32];
+  std::strftime(startStr, sizeof(startStr), "%Y-%m-%d %H:%M:%S", &tm);
+  fmt::format_to(std::back_inserter(out),
+                 "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{{\"startTime\":\"{}\"}}}}\n",
+                 startStr);
+
+  if (!replace_file(path, out))
+  {
+    SPDLOG_ERROR("Failed to write the trace to {}", path.string());
+    return false;
+  }
+  SPDLOG_INFO("Trace written to {}", path.string());
+  return true;
+#endif
+}
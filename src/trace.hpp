@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+
+// Scoped timing zones kept in a ring per thread, dumped on demand as Chrome trace JSON that
+// chrome://tracing and Perfetto open. Configure with VOICETUBER_TRACE=OFF to compile the zones out.
+namespace Trace
+{
+  // microseconds since the start of the process
+  auto now() -> uint64_t;
+  // names the calling thread in the dump
+  auto setThreadName(const char *) -> void;
+  // writes the zones recorded so far; false on error or when tracing is compiled out
+  auto dump(const std::filesystem::path &) -> bool;
+
+  class Zone
+  {
+  public:
+    Zone(const char *aName) : name(aName), start(now()) {}
+    Zone(const Zone &) = delete;
+    auto operator=(const Zone &) -> Zone & = delete;
+    ~Zone();
+
+  private:
+    const char *name;
+    uint64_t start;
+  };
+} // namespace Trace
+
+#ifdef VOICETUBER_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// name has to be a string literal, only the pointer is stored
+#define TRACE_ZONE(name) const auto TRACE_CONCAT(traceZone, __LINE__) = Trace::Zone{name}
+#else
+#define TRACE_ZONE(name)
+#endif
@@ -0,0 +1,141 @@
+#include "transforms.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+Transforms::Slot::Slot(Transforms &aTransforms)
+  : owner(&aTransforms), handle(aTransforms.alloc())
+{
+}
+
+Transforms::Slot::Slot(const Slot &other) : owner(other.owner), handle(owner->alloc())
+{
+  get<&Page::loc>() = other.get<&Page::loc>();
+  get<&Page::scale>() = other.get<&Page::scale>();
+  get<&Page::pivot>() = other.get<&Page::pivot>();
+  get<&Page::rot>() = other.get<&Page::rot>();
+  get<&Page::dLoc>() = other.get<&Page::dLoc>();
+  get<&Page::dRot>() = other.get<&Page::dRot>();
+  get<&Page::dScale>() = other.get<&Page::dScale>();
+  get<&Page::zOrder>() = other.get<&Page::zOrder>();
+  get<&Page::visible>() = other.get<&Page::visible>();
+  get<&Page::onScreen>() = other.get<&Page::onScreen>();
+  get<&Page::size>() = other.get<&Page::size>();
+  get<&Page::world>() = other.get<&Page::world>();
+}
+
+Transforms::Slot::~Slot()
+{
+  owner->free(handle);
+}
+
+auto Transforms::alloc() -> Handle
+{
+  if (freeSlots.empty())
+  {
+    const auto first = static_cast<Handle>(pages.size() * PageSize);
+    pages.emplace_back(std::make_unique<Page>());
+    for (auto i = PageSize; i-- > 0;)
+      freeSlots.push_back(first + i);
+  }
+  const auto h = freeSlots.back();
+  freeSlots.pop_back();
+
+  auto &p = *pages[h / PageSize];
+  const auto s = h % PageSize;
+  p.loc[s] = {0.f, 0.f};
+  p.scale[s] = {1.f, 1.f};
+  p.pivot[s] = {0.f, 0.f};
+  p.rot[s] = 0.f;
+  p.dLoc[s] = {0.f, 0.f};
+  p.dRot[s] = 0.f;
+  p.dScale[s] = {0.f, 0.f};
+  p.zOrder[s] = 0;
+  p.visible[s] = true;
+  p.onScreen[s] = true;
+  p.size[s] = {1.f, 1.f};
+  p.world[s] = glm::mat4{1.f};
+  return h;
+}
+
+auto Transforms::free(Handle h) -> void
+{
+  assert(h / PageSize < pages.size());
+  freeSlots.push_back(h);
+}
+
+auto Transforms::clearOrder() -> void
+{
+  order.clear();
+  parents.clear();
+}
+
+auto Transforms::pushOrder(Handle h, int parent) -> int
+{
+  assert(parent < static_cast<int>(order.size()));
+  order.push_back(h);
+  parents.push_back(parent);
+  return static_cast<int>(order.size()) - 1;
+}
+
+auto Transforms::propagate(const glm::mat4 &base) -> void
+{
+  for (auto i = 0U; i < order.size(); ++i)
+  {
+    const auto h = order[i];
+    auto &p = *pages[h / PageSize];
+    const auto s = h % PageSize;
+
+    // translate(loc + dLoc) * rotate(rot + dRot) * scale(scale + dScale) * translate(-pivot)
+    const auto a = (p.rot[s] + p.dRot[s]) * std::numbers::pi_v<float> / 180.f;
+    const auto c = std::cos(a);
+    const auto sn = std::sin(a);
+    const auto sx = p.scale[s].x + p.dScale[s].x;
+    const auto sy = p.scale[s].y + p.dScale[s].y;
+    const auto &pv = p.pivot[s];
+    auto local = glm::mat4{1.f};
+    local[0][0] = c * sx;
+    local[0][1] = sn * sx;
+    local[1][0] = -sn * sy;
+    local[1][1] = c * sy;
+    local[3][0] = p.loc[s].x + p.dLoc[s].x - c * sx * pv.x + sn * sy * pv.y;
+    local[3][1] = p.loc[s].y + p.dLoc[s].y - sn * sx * pv.x - c * sy * pv.y;
+
+    const auto parent = parents[i];
+    if (parent < 0)
+      p.world[s] = base * local;
+    else
+    {
+      const auto ph = order[static_cast<size_t>(parent)];
+      p.world[s] = pages[ph / PageSize]->world[ph % PageSize] * local;
+    }
+  }
+}
+
+auto Transforms::cull(const glm::mat4 &projMat) -> void
+{
+  for (auto h : order)
+  {
+    auto &p = *pages[h / PageSize];
+    const auto s = h % PageSize;
+    const auto mvp = projMat * p.world[s];
+    const auto &sz = p.size[s];
+    auto minX = std::numeric_limits<float>::max();
+    auto minY = std::numeric_limits<float>::max();
+    auto maxX = -std::numeric_limits<float>::max();
+    auto maxY = -std::numeric_limits<float>::max();
+    for (const auto &corner : {glm::vec2{0.f, 0.f}, glm::vec2{sz.x, 0.f}, sz, glm::vec2{0.f, sz.y}})
+    {
+      const auto v = mvp * glm::vec4{corner, 0.f, 1.f};
+      const auto x = v.x / v.w;
+      const auto y = v.y / v.w;
+      minX = std::min(minX, x);
+      minY = std::min(minY, y);
+      maxX = std::max(maxX, x);
+      maxY = std::max(maxY, y);
+    }
+    p.onScreen[s] = maxX >= -1.f && minX <= 1.f && maxY >= -1.f && minY <= 1.f;
+  }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <memory>
+#include <vector>
+
+// Transform and visibility state of all the nodes stored as structure of arrays. Slots are
+// allocated in fixed size pages, so references to a slot stay valid while other nodes come and go.
+class Transforms
+{
+public:
+  using Handle = uint32_t;
+  static constexpr auto PageSize = 256U;
+
+  struct Page
+  {
+    std::array<glm::vec2, PageSize> loc;
+    std::array<glm::vec2, PageSize> scale;
+    std::array<glm::vec2, PageSize> pivot;
+    std::array<float, PageSize> rot;
+    std::array<glm::vec2, PageSize> dLoc;
+    std::array<float, PageSize> dRot;
+    std::array<glm::vec2, PageSize> dScale;
+    std::array<int, PageSize> zOrder;
+    std::array<bool, PageSize> visible;
+    std::array<bool, PageSize> onScreen;
+    std::array<glm::vec2, PageSize> size;
+    std::array<glm::mat4, PageSize> world;
+  };
+
+  // owns a slot, copying a slot allocates a new one with the same values
+  class Slot
+  {
+  public:
+    Slot(Transforms &);
+    Slot(const Slot &);
+    auto operator=(const Slot &) -> Slot & = delete;
+    ~Slot();
+
+    template <auto Field>
+    auto get() const -> auto &
+    {
+      return owner->get<Field>(handle);
+    }
+
+    auto id() const -> Handle { return handle; }
+    auto transforms() const -> Transforms & { return *owner; }
+
+  private:
+    Transforms *owner;
+    Handle handle;
+  };
+
+  template <auto Field>
+  auto get(Handle h) -> auto &
+  {
+    return (pages[h / PageSize].get()->*Field)[h % PageSize];
+  }
+
+  // the traversal order is rebuilt every frame, parents always come before their children
+  auto clearOrder() -> void;
+  auto pushOrder(Handle, int parent) -> int;
+  // computes world matrices of the nodes in the traversal order
+  auto propagate(const glm::mat4 &base) -> void;
+  // marks nodes whose bounding rectangle is outside of the clip space
+  auto cull(const glm::mat4 &projMat) -> void;
+
+private:
+  std::vector<std::unique_ptr<Page>> pages;
+  std::vector<Handle> freeSlots;
+  std::vector<Handle> order;
+  std::vector<int> parents;
+
+  auto alloc() -> Handle;
+  auto free(Handle) -> void;
+};
@@ -3,6 +3,7 @@
 #endif
 
 #include "twitch.hpp"
+#include "trace.hpp"
 #include <algorithm>
 #include <optional>
 #include <scn/scn.h>
@@ -243,6 +244,7 @@ auto Twitch::readStart() -> void
 
 auto Twitch::parseMsg() -> void
 {
+  TRACE_ZONE("Twitch::parseMsg");
   for (;;)
   {
     auto it = std::find(std::begin(buf), std::end(buf), '\n');
@@ -2,10 +2,17 @@
 #include "imgui-helpers.hpp"
 #include "texture.hpp"
 #include "undo.hpp"
+#include <fmt/format.h>
 #include <imgui.h>
 
 namespace Ui
 {
+  // labels repeat across nodes, the address of the value tells edits of two nodes apart
+  static auto tag(const char *label, const void *v) -> std::string
+  {
+    return fmt::format("{}@{}", label, v);
+  }
+
   auto textRj(std::string_view v, float offset) -> void
   {
     ImGui::SetCursorPosX(ImGui::GetCursorPosX() + ImGui::GetColumnWidth() -
@@ -31,7 +38,7 @@ namespace Ui
     const auto oldV = v;
     if (ImGui::DragFloat(label, &v, v_speed, v_min, v_max, format, flags))
     {
-      undo.record([newV = v, &v]() { v = newV; }, [oldV, &v]() { v = oldV; }, label);
+      undo.record([newV = v, &v]() { v = newV; }, [oldV, &v]() { v = oldV; }, tag(label, &v));
       return true;
     }
     return false;
@@ -47,7 +54,7 @@ namespace Ui
     const auto oldV = v;
     if (ImGui::InputInt(label, &v, step, step_fast, flags))
     {
-      undo.record([newV = v, &v]() { v = newV; }, [oldV, &v]() { v = oldV; }, label);
+      undo.record([newV = v, &v]() { v = newV; }, [oldV, &v]() { v = oldV; }, tag(label, &v));
       return true;
     }
     return false;
@@ -64,7 +71,7 @@ namespace Ui
     const auto oldV = v;
     if (ImGui::SliderFloat(label, &v, v_min, v_max, format, flags))
     {
-      undo.record([newV = v, &v]() { v = newV; }, [oldV, &v]() { v = oldV; }, label);
+      undo.record([newV = v, &v]() { v = newV; }, [oldV, &v]() { v = oldV; }, tag(label, &v));
       return true;
     }
     return false;
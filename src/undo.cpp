@@ -1,17 +1,55 @@
 #include "undo.hpp"
+#include <algorithm>
 #include <cmath>
 
-auto Undo::record(Operation action, Operation rollback, std::string tag) -> void
+auto Undo::push(Operation action, Operation rollback, std::string tag, size_t bytes) -> void
 {
   action();
-  undoStack.emplace_back(std::move(tag), SDL_GetTicks(), std::move(action), std::move(rollback));
+  ++generation_;
+  for (const auto &rec : redoStack)
+    bytes_ -= rec.bytes;
   redoStack.clear();
+
+  const auto now = SDL_GetTicks();
+  if (hasUndo() && !tag.empty() && undoStack.back().tag == tag && now - undoStack.back().timestamp < CoalesceMs)
+  {
+    // dragging a slider records every frame, keep the oldest rollback and the newest action
+    auto &rec = undoStack.back();
+    bytes_ -= rec.bytes;
+    rec.action = std::move(action);
+    rec.timestamp = now;
+    rec.bytes = std::max(rec.bytes, bytes);
+    bytes_ += rec.bytes;
+    return;
+  }
+
+  undoStack.emplace_back(std::move(tag), now, std::move(action), std::move(rollback), bytes);
+  bytes_ += bytes;
+  trim();
+}
+
+auto Undo::trim() -> void
+{
+  // the latest record always stays so the edit in progress can be undone
+  while (bytes_ > budget && undoStack.size() > 1)
+  {
+    bytes_ -= undoStack.front().bytes;
+    undoStack.pop_front();
+  }
+}
+
+auto Undo::setBudget(size_t v) -> void
+{
+  budget = v;
+  trim();
 }
 
 auto Undo::undo() -> void
 {
   if (!hasUndo())
     return;
+  ++generation_;
+  ++historyGeneration_;
   std::string lastTag;
   Uint32 lastTimestamp;
   do
@@ -23,13 +61,15 @@ auto Undo::undo() -> void
     redoStack.emplace_back(std::move(rec));
     undoStack.pop_back();
   } while (hasUndo() && !lastTag.empty() && lastTag == undoStack.back().tag &&
-           std::abs(static_cast<int64_t>(lastTimestamp) - undoStack.back().timestamp) < 500);
+           std::abs(static_cast<int64_t>(lastTimestamp) - undoStack.back().timestamp) < CoalesceMs);
 }
 
 auto Undo::redo() -> void
 {
   if (!hasRedo())
     return;
+  ++generation_;
+  ++historyGeneration_;
   std::string lastTag;
   Uint32 lastTimestamp;
   do
@@ -41,7 +81,7 @@ auto Undo::redo() -> void
     undoStack.emplace_back(std::move(rec));
     redoStack.pop_back();
   } while (hasRedo() && !lastTag.empty() && lastTag == redoStack.back().tag &&
-           std::abs(static_cast<int64_t>(lastTimestamp) - redoStack.back().timestamp) < 500);
+           std::abs(static_cast<int64_t>(lastTimestamp) - redoStack.back().timestamp) < CoalesceMs);
 }
 
 auto Undo::hasUndo() const -> bool
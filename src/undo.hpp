@@ -1,8 +1,9 @@
 #pragma once
 #include <SDL.h>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <string>
-#include <vector>
 
 class Undo
 {
@@ -10,25 +11,50 @@ public:
   using Operation = std::move_only_function<void()>;
   struct Action
   {
-    Action(std::string aTag, Uint32 aTimestamp, Operation aAction, Operation aRollback)
+    Action(std::string aTag, Uint32 aTimestamp, Operation aAction, Operation aRollback, size_t aBytes)
       : tag(std::move(aTag)),
         timestamp(aTimestamp),
         action(std::move(aAction)),
-        rollback(std::move(aRollback))
+        rollback(std::move(aRollback)),
+        bytes(aBytes)
     {
     }
     std::string tag;
     Uint32 timestamp;
     Operation action;
     Operation rollback;
+    size_t bytes; // approximate memory held by the closures
   };
-  auto record(Operation action, Operation rollback, std::string tag = "") -> void;
+  // records with the same non-empty tag within CoalesceMs are merged into one, extraBytes is what the
+  // closures hold on the heap beyond their own size
+  template <typename A, typename R>
+  auto record(A action, R rollback, std::string tag = "", size_t extraBytes = 0) -> void
+  {
+    const auto bytes = sizeof(Action) + sizeof(A) + sizeof(R) + tag.capacity() + extraBytes;
+    push(std::move(action), std::move(rollback), std::move(tag), bytes);
+  }
   auto undo() -> void;
   auto redo() -> void;
   auto hasUndo() const -> bool;
   auto hasRedo() const -> bool;
+  // the oldest records are dropped when the history grows over the budget
+  auto setBudget(size_t) -> void;
+  auto bytes() const -> size_t { return bytes_; }
+  // bumped by every change
+  auto generation() const -> uint64_t { return generation_; }
+  // bumped by undo and redo only, those can touch any node
+  auto historyGeneration() const -> uint64_t { return historyGeneration_; }
+
+  static constexpr Uint32 CoalesceMs = 500;
 
 private:
-  std::vector<Action> undoStack;
-  std::vector<Action> redoStack;
+  uint64_t generation_ = 0;
+  uint64_t historyGeneration_ = 0;
+  size_t budget = 64 * 1024 * 1024;
+  size_t bytes_ = 0;
+  std::deque<Action> undoStack;
+  std::deque<Action> redoStack;
+
+  auto push(Operation action, Operation rollback, std::string tag, size_t bytes) -> void;
+  auto trim() -> void;
 };
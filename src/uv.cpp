@@ -320,6 +320,39 @@ namespace uv
     return loop_;
   }
 
+  auto Uv::createAsync(Async::Cb cb) -> Async
+  {
+    return Async{loop_, std::move(cb)};
+  }
+
+  Async::Async(uv_loop_t *loop, Cb aCb)
+    : async(new uv_async_t), cb(std::move(aCb))
+  {
+    uv_async_init(loop, async, [](uv_async_t *handle) {
+      auto self = static_cast<Async *>(handle->data);
+      if (!self || !self->cb)
+      {
+        SPDLOG_DEBUG("The Async callback is not set up");
+        return;
+      }
+      self->cb();
+    });
+    async->data = this;
+  }
+
+  Async::~Async()
+  {
+    // the handle has to outlive the close
+    async->data = nullptr;
+    uv_close(reinterpret_cast<uv_handle_t *>(async),
+             [](uv_handle_t *handle) { delete reinterpret_cast<uv_async_t *>(handle); });
+  }
+
+  auto Async::send() -> int
+  {
+    return uv_async_send(async);
+  }
+
   Idle::Idle(uv_loop_t *loop)
     : idle(std::make_unique<uv_idle_t>())
   {
@@ -102,6 +102,23 @@ namespace uv
     Cb cb = nullptr;
   };
 
+  class Async
+  {
+    friend class Uv;
+
+  public:
+    using Cb = std::function<auto()->void>;
+    Async(const Async &) = delete;
+    ~Async();
+    // the only call that is safe from other threads, several sends may wake the loop only once
+    auto send() -> int;
+
+  private:
+    Async(uv_loop_t *, Cb);
+    uv_async_t *async;
+    Cb cb;
+  };
+
   class Uv
   {
   public:
@@ -109,6 +126,7 @@ namespace uv
 
     Uv();
     auto connect(const std::string &domain, const std::string &port, ConnectCb) -> int;
+    auto createAsync(Async::Cb) -> Async;
     auto createFsEvent() -> FsEvent;
     auto createIdle() -> Idle;
     auto createPrepare() -> Prepare;
@@ -7,5 +7,5 @@ auto appVersion() -> const char *
 
 auto saveVersion() -> uint32_t
 {
-  return 2;
+  return 3;
 }
@@ -1,11 +1,15 @@
 #include "wav-2-visemes.hpp"
+#include "jobs.hpp"
+#include "trace.hpp"
+#include <chrono>
+#include <fmt/std.h>
 #include <pocketsphinx.h>
 #include <scn/scn.h>
 #include <spdlog/spdlog.h>
 #include <stdexcept>
 #include <unordered_map>
 
-Wav2Visemes::Wav2Visemes()
+Wav2Visemes::Model::Model()
   : config([]() {
       auto ret = ps_config_init(nullptr);
       ps_default_search_args(ret);
@@ -15,32 +19,72 @@ Wav2Visemes::Wav2Visemes()
       ps_config_set_bool(ret, "backtrace", TRUE);
       ps_config_set_float(ret, "beam", 1e-20);
       ps_config_set_float(ret, "lw", 2.0);
+      // map the model files instead of reading them into the heap
+      ps_config_set_bool(ret, "mmap", TRUE);
 
       return ret;
     }()),
-    decoder([this]() {
-      auto ret = ps_init(config);
-      if (!ret)
-        throw std::runtime_error("PocketSphinx decoder init failed");
-      return ret;
-    }()),
-    ep([]() {
+    decoder(ps_init(config))
+{
+  if (!decoder)
+  {
+    ps_config_free(config);
+    throw std::runtime_error("PocketSphinx decoder init failed");
+  }
+}
+
+Wav2Visemes::Model::~Model()
+{
+  ps_free(decoder);
+  ps_config_free(config);
+}
+
+Wav2Visemes::Wav2Visemes(Jobs &jobs, std::function<auto()->void> onReady)
+  : ep([]() {
       auto ret = ps_endpointer_init(0.15f, 0.45f, PS_VAD_LOOSE, 0, 0);
       if (!ret)
         throw std::runtime_error("PocketSphinx endpointer init failed");
       return ret;
     }())
 {
+  auto loaded = std::make_shared<std::shared_ptr<Model>>();
+  jobs.submit(
+    [loaded]() {
+      TRACE_ZONE("Wav2Visemes::loadModel");
+      const auto start = std::chrono::steady_clock::now();
+      try
+      {
+        *loaded = std::make_shared<Model>();
+      }
+      catch (const std::runtime_error &e)
+      {
+        SPDLOG_ERROR("{:t}", e);
+        return;
+      }
+      SPDLOG_INFO("PocketSphinx model loaded in {} ms",
+                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count());
+    },
+    [this, loaded, onReady = std::move(onReady)]() {
+      if (!*loaded)
+        return;
+      model = std::move(*loaded);
+      onReady();
+    });
 }
 
 Wav2Visemes::~Wav2Visemes()
 {
   ps_endpointer_free(ep);
-  ps_free(decoder);
-  ps_config_free(config);
 }
+
 auto Wav2Visemes::ingest(Wav wav, bool /*overlap*/) -> void
 {
+  TRACE_ZONE("Wav2Visemes::ingest");
+  if (!model)
+    return;
+  const auto decoder = model->decoder;
   while (!wav.empty())
   {
     const auto fs = frameSize();
@@ -143,6 +187,11 @@ auto Wav2Visemes::frameSize() const -> int
   return static_cast<int>(ps_endpointer_frame_size(ep));
 }
 
+auto Wav2Visemes::isReady() const -> bool
+{
+  return model != nullptr;
+}
+
 auto Wav2Visemes::reg(VisemesSink &v) -> void
 {
   sinks.push_back(v);
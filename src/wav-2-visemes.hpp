@@ -4,23 +4,38 @@
 #include "visemes-sink.hpp"
 #include "wav.hpp"
 #include <functional>
+#include <memory>
 #include <pocketsphinx.h>
 
+class Jobs;
+
 class Wav2Visemes final : public AudioSink
 {
 public:
-  Wav2Visemes();
+  // the acoustic model is loaded on a worker, onReady is called on the loop once it is in place;
+  // until then the incoming audio is dropped
+  Wav2Visemes(Jobs &, std::function<auto()->void> onReady);
   ~Wav2Visemes() final;
   auto ingest(Wav, bool overlap) -> void final;
   auto sampleRate() const -> int final;
   auto frameSize() const -> int;
   auto reg(VisemesSink &) -> void;
   auto unreg(VisemesSink &) -> void;
+  auto isReady() const -> bool;
 
 private:
   std::vector<std::reference_wrapper<VisemesSink>> sinks;
-  ps_config_t *config = nullptr;
-  ps_decoder_t *decoder = nullptr;
+  struct Model
+  {
+    Model();
+    Model(const Model &) = delete;
+    auto operator=(const Model &) -> Model & = delete;
+    ~Model();
+    ps_config_t *config = nullptr;
+    ps_decoder_t *decoder = nullptr;
+  };
+
+  std::shared_ptr<Model> model;
   ps_endpointer_t *ep = nullptr;
   Wav buf;
 };